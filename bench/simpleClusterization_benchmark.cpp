@@ -0,0 +1,449 @@
+///@file simpleClusterization_benchmark.cpp
+///@brief Times the main entry points of the library on synthetic gaussian blobs, scaling the number of datapoints, dimensions and clusters in turn
+///@details Every benchmark runs in a child process, so that its peak resident memory is its own and a crash doesn't stop the others.
+///         The results are written as JSON, one benchmark per line so that two runs can be compared with a plain diff, and can be checked against
+///         a previous output with --baseline, in which case the exit status is 1 if any benchmark got slower than the tolerance allows.
+///         Build it with the library sources, e.g.
+///             g++ -O2 -std=c++17 -pthread -Iinclude -Ibench -I/usr/include/eigen3 bench/simpleClusterization_benchmark.cpp source/*.cpp -o benchmark
+///         and run benchmark --help for the options.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+#include <simpleClusterization.hpp>
+#include <simpleClusterization_synthetic.hpp>
+
+using namespace Eigen;
+
+namespace{
+
+///The number of datapoints the predict benchmark labels per call, a typical request batch
+const int predictBatchRows = 1024;
+///The number of memberships per datapoint the sparseFcm benchmark keeps
+const int sparseMembershipsNumber = 4;
+
+///Parameters of the whole run, from the command line
+struct BenchmarkOptions{
+    std::string         outputPath;
+    std::string         baselinePath;
+    std::string         filter;
+    ///A benchmark is a regression when it's slower than its baseline by more than this fraction
+    float               tolerance           = 0.1;
+    int                 repeats             = 3;
+    int                 threadsNumber       = 1;
+    ///Multiplies the number of datapoints of every scenario, e.g. 0.1 for a quick check
+    float               scale               = 1.;
+    float               overlap             = 0.5;
+    float               outliersFraction    = 0.01;
+    unsigned long long  seed                = 42;
+};
+
+///The sizes of a scenario
+struct Scenario{
+    int entitiesNumber;
+    int statsNumber;
+    int clustersNumber;
+};
+
+///What a benchmark measured
+struct BenchmarkResult{
+    std::string         name;
+    double              seconds             = 0;
+    double              medianSeconds       = 0;
+    long long           distanceEvaluations = -1;
+    ///The iterations of all the runs of the algorithm, 0 for the non-iterative benchmarks
+    long long           iterations          = 0;
+    long long           peakMemoryBytes     = 0;
+    ///A measure of the quality of the result, to catch optimizations that change it
+    double              fitness             = 0;
+};
+
+///A metric that counts its calls, to measure how many distances an algorithm evaluates
+template<typename Metric>
+struct CountingMetric{
+    Metric                  metric;
+    std::atomic<long long>  *counter;
+
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        counter->fetch_add(1, std::memory_order_relaxed);
+        return metric(v1, v2);
+    }
+};
+
+}
+
+///Keeps the triangle inequality of the wrapped metric, so that the counted run takes the same algorithm, but not its batched code paths, which bypass the functor
+template<typename Metric>
+struct MetricTraits<CountingMetric<Metric>>{
+    static constexpr bool isSquaredEuclidean = false;
+    static constexpr bool satisfiesTriangleInequality = MetricTraits<Metric>::satisfiesTriangleInequality;
+    static float metricDistance(float value){
+        return MetricTraits<Metric>::metricDistance(value);
+    }
+};
+
+namespace{
+
+///@return The peak resident memory of the process in bytes
+long long peakResidentBytes(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024LL;
+#endif
+}
+
+/*!
+ * @brief       Runs a function options.repeats times and records the fastest and median times and the memory it added to the peak
+ * @param[in]   options     The parameters of the run
+ * @param[in]   function    The code to time, called with no arguments
+ * @param[out]  result      Where the times and memory are written
+*/
+template<typename Function>
+void timeRepeats(
+        const BenchmarkOptions  &options,
+        Function                &&function,
+        BenchmarkResult         &result
+    ){
+    const long long startingPeak = peakResidentBytes();
+    std::vector<double> times;
+    for(int r=0;r<std::max(options.repeats, 1);++r){
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    result.seconds = times.front();
+    result.medianSeconds = times[times.size() / 2];
+    result.peakMemoryBytes = peakResidentBytes() - startingPeak;
+}
+
+std::string scenarioName(
+        const std::string   &benchmark,
+        const Scenario      &scenario
+    ){
+    return benchmark + "/n=" + std::to_string(scenario.entitiesNumber) + "/d=" + std::to_string(scenario.statsNumber) + "/k=" + std::to_string(scenario.clustersNumber);
+}
+
+///Runs one benchmark on the dataset of a scenario, in the current process
+BenchmarkResult runBenchmark(
+        const BenchmarkOptions  &options,
+        const std::string       &benchmark,
+        const Scenario          &scenario
+    ){
+    SyntheticDatasetOptions datasetOptions;
+    datasetOptions.entitiesNumber   = scenario.entitiesNumber;
+    datasetOptions.statsNumber      = scenario.statsNumber;
+    datasetOptions.blobsNumber      = scenario.clustersNumber;
+    datasetOptions.overlap          = options.overlap;
+    datasetOptions.outliersFraction = options.outliersFraction;
+    datasetOptions.seed             = options.seed;
+    MatrixXfR entities;
+    MatrixXf centers;
+    VectorXi trueLabels;
+    makeGaussianBlobs(datasetOptions, entities, centers, trueLabels);
+    const int entitiesNumber = scenario.entitiesNumber;
+    const int clustersNumber = scenario.clustersNumber;
+    auto context = ClusteringContext::create(nullptr, options.threadsNumber);
+    BenchmarkResult result;
+    result.name = scenarioName(benchmark, scenario);
+    MatrixXf centroids(clustersNumber, scenario.statsNumber);
+    VectorXi labels(entitiesNumber);
+    VectorXi counts(clustersNumber);
+    std::atomic<long long> distanceEvaluations(0);
+    const CountingMetric<SquaredEuclideanMetric> countingMetric{SquaredEuclideanMetric(), &distanceEvaluations};
+    //The stats are only attached to the counting run, so that the timed ones don't read the clock
+    ClusteringStats stats;
+    if(benchmark=="kmeans"){
+        auto run = [&](const auto &metric){
+            std::mt19937 generator(std::uint32_t(options.seed));
+            kmeansGenerator(entities, centroids, labels, counts, metric, generator, KmeansOptions(), *context);
+        };
+        timeRepeats(options, [&](){ run(SquaredEuclideanMetric()); }, result);
+        result.fitness = daviesBouldinIndex(entities, centroids, labels, counts, SquaredEuclideanMetric(), *context);
+        context->setStats(&stats);
+        run(countingMetric);
+        result.distanceEvaluations = distanceEvaluations;
+    }else if(benchmark=="fcm" || benchmark=="fuzzyWeights"){
+        MatrixXfR weights(clustersNumber, entitiesNumber);
+        FcmOptions fcmOptions;
+        //The memberships start from the true centers, so that the random initialization doesn't weigh on the time
+        fcmOptions.initializeFromCentroids = true;
+        if(benchmark=="fcm"){
+            auto run = [&](const auto &metric){
+                centroids = centers;
+                FCMGenerator(entities, centroids, weights, metric, fcmOptions, *context);
+            };
+            timeRepeats(options, [&](){ run(SquaredEuclideanMetric()); }, result);
+            result.fitness = (centroids - centers).squaredNorm();
+            context->setStats(&stats);
+            run(countingMetric);
+        }else{
+            timeRepeats(options, [&](){ calculateFuzzyWeights(entities, centers, weights, SquaredEuclideanMetric(), *context); }, result);
+            result.fitness = weights.maxCoeff();
+            calculateFuzzyWeights(entities, centers, weights, countingMetric, *context);
+        }
+        result.distanceEvaluations = distanceEvaluations;
+    }else if(benchmark=="sparseFcm"){
+        SparseMemberships weights(entitiesNumber, sparseMembershipsNumber);
+        FcmOptions fcmOptions;
+        fcmOptions.initializeFromCentroids = true;
+        auto run = [&](const auto &metric){
+            centroids = centers;
+            FCMGenerator(entities, centroids, weights, metric, fcmOptions, *context);
+        };
+        timeRepeats(options, [&](){ run(SquaredEuclideanMetric()); }, result);
+        result.fitness = (centroids - centers).squaredNorm();
+        context->setStats(&stats);
+        run(countingMetric);
+        result.distanceEvaluations = distanceEvaluations;
+    }else if(benchmark=="sweep"){
+        MatrixXfR weights(clustersNumber, entitiesNumber);
+        SweepOptions sweepOptions;
+        sweepOptions.seed = options.seed;
+        sweepOptions.warmStart = true;
+        int foundClustersNumber = 0;
+        auto run = [&](const auto &metric){
+            foundClustersNumber = clusterGeneratorApproximate(entities, centroids, weights, labels, metric, sweepOptions, *context);
+        };
+        timeRepeats(options, [&](){ run(SquaredEuclideanMetric()); }, result);
+        result.fitness = foundClustersNumber;
+        context->setStats(&stats);
+        run(countingMetric);
+        result.distanceEvaluations = distanceEvaluations;
+    }else if(benchmark=="predict"){
+        //Serving new datapoints in batches against a model built from the true centers
+        const ClusteringModel model(centers, VectorXi::Ones(clustersNumber));
+        VectorXf distances(entitiesNumber);
+        auto run = [&](const auto &metric){
+            for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=predictBatchRows){
+                const int batchRows = std::min(predictBatchRows, entitiesNumber - firstEntity);
+                model.predict(entities.middleRows(firstEntity, batchRows), labels.segment(firstEntity, batchRows), distances.segment(firstEntity, batchRows), metric, *context);
+            }
+        };
+        timeRepeats(options, [&](){ run(SquaredEuclideanMetric()); }, result);
+        result.fitness = distances.mean();
+        run(countingMetric);
+        result.distanceEvaluations = distanceEvaluations;
+    }
+    result.iterations = stats.iterations;
+    return result;
+}
+
+std::string resultJson(
+        const BenchmarkResult   &result,
+        const Scenario          &scenario,
+        double                  baselineSeconds
+    ){
+    char line[512];
+    std::snprintf(line, sizeof(line), "{\"name\":\"%s\",\"n\":%d,\"d\":%d,\"k\":%d,\"seconds\":%.6g,\"medianSeconds\":%.6g,\"distanceEvaluations\":%lld,\"iterations\":%lld,\"peakMemoryBytes\":%lld,\"fitness\":%.6g",
+                  result.name.c_str(), scenario.entitiesNumber, scenario.statsNumber, scenario.clustersNumber, result.seconds, result.medianSeconds,
+                  result.distanceEvaluations, result.iterations, result.peakMemoryBytes, result.fitness);
+    std::string json = line;
+    if(baselineSeconds > 0){
+        std::snprintf(line, sizeof(line), ",\"baselineSeconds\":%.6g,\"ratio\":%.4f", baselineSeconds, result.seconds / baselineSeconds);
+        json += line;
+    }
+    return json + "}";
+}
+
+/*!
+ * @brief       Runs a benchmark in a child process and reads its result back through a pipe
+ * @return      false if the child failed, in which case result only holds the name
+*/
+bool runIsolated(
+        const BenchmarkOptions  &options,
+        const std::string       &benchmark,
+        const Scenario          &scenario,
+        BenchmarkResult         &result
+    ){
+    result = BenchmarkResult();
+    result.name = scenarioName(benchmark, scenario);
+    int pipeEnds[2];
+    if(pipe(pipeEnds)!=0){
+        return false;
+    }
+    std::fflush(nullptr);
+    const pid_t child = fork();
+    if(child < 0){
+        close(pipeEnds[0]);
+        close(pipeEnds[1]);
+        return false;
+    }
+    if(child==0){
+        close(pipeEnds[0]);
+        const BenchmarkResult childResult = runBenchmark(options, benchmark, scenario);
+        char message[256];
+        const int length = std::snprintf(message, sizeof(message), "%.17g %.17g %lld %lld %lld %.17g", childResult.seconds, childResult.medianSeconds,
+                                         childResult.distanceEvaluations, childResult.iterations, childResult.peakMemoryBytes, childResult.fitness);
+        const bool written = write(pipeEnds[1], message, length)==length;
+        close(pipeEnds[1]);
+        _exit(written ? 0 : 1);
+    }
+    close(pipeEnds[1]);
+    std::string message;
+    char buffer[256];
+    ssize_t readBytes;
+    while((readBytes = read(pipeEnds[0], buffer, sizeof(buffer))) > 0){
+        message.append(buffer, readBytes);
+    }
+    close(pipeEnds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status)!=0){
+        return false;
+    }
+    std::istringstream stream(message);
+    return bool(stream >> result.seconds >> result.medianSeconds >> result.distanceEvaluations >> result.iterations >> result.peakMemoryBytes >> result.fitness);
+}
+
+///Reads the times of a previous output, which has one benchmark per line
+std::map<std::string, double> readBaseline(
+        const std::string &path
+    ){
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line)){
+        const size_t nameStart = line.find("\"name\":\"");
+        const size_t secondsStart = line.find("\"seconds\":");
+        if(nameStart==std::string::npos || secondsStart==std::string::npos){
+            continue;
+        }
+        const size_t nameEnd = line.find('"', nameStart + 8);
+        baseline[line.substr(nameStart + 8, nameEnd - nameStart - 8)] = std::atof(line.c_str() + secondsStart + 10);
+    }
+    return baseline;
+}
+
+///The scenarios of the run: the number of datapoints, of dimensions and of clusters each scaled in turn from a common base
+std::vector<Scenario> makeScenarios(
+        const BenchmarkOptions &options
+    ){
+    auto scaled = [&](int entitiesNumber){
+        return std::max(int(float(entitiesNumber) * options.scale), 100);
+    };
+    std::vector<Scenario> scenarios;
+    std::set<std::tuple<int, int, int>> seen;
+    auto add = [&](int entitiesNumber, int statsNumber, int clustersNumber){
+        const Scenario scenario{scaled(entitiesNumber), statsNumber, clustersNumber};
+        if(seen.insert(std::make_tuple(scenario.entitiesNumber, statsNumber, clustersNumber)).second){
+            scenarios.push_back(scenario);
+        }
+    };
+    for(int entitiesNumber : {10000, 40000, 160000}){
+        add(entitiesNumber, 16, 8);
+    }
+    for(int statsNumber : {4, 64}){
+        add(40000, statsNumber, 8);
+    }
+    for(int clustersNumber : {4, 32, 128}){
+        add(40000, 16, clustersNumber);
+    }
+    return scenarios;
+}
+
+void printUsage(){
+    std::fprintf(stderr,
+        "usage: benchmark [options]\n"
+        "  --output PATH      write the JSON results to PATH instead of the standard output\n"
+        "  --baseline PATH    compare the times to a previous output, exit with 1 on a regression\n"
+        "  --tolerance F      the allowed slowdown relative to the baseline (default 0.1)\n"
+        "  --filter TEXT      only run the benchmarks whose name contains TEXT\n"
+        "  --repeats N        time every benchmark N times and keep the fastest (default 3)\n"
+        "  --threads N        the threads of the library's thread pool, 0 for one per hardware thread (default 1)\n"
+        "  --scale F          multiply the number of datapoints of every scenario by F (default 1)\n"
+        "  --overlap F        the overlap of the blobs, see SyntheticDatasetOptions (default 0.5)\n"
+        "  --outliers F       the fraction of uniform outliers (default 0.01)\n"
+        "  --seed N           the seed of the datasets and of the algorithms (default 42)\n");
+}
+
+}
+
+int main(
+        int     argc,
+        char    **argv
+    ){
+    BenchmarkOptions options;
+    for(int a=1;a<argc;++a){
+        const std::string argument = argv[a];
+        if(argument=="--help" || a + 1>=argc){
+            printUsage();
+            return argument=="--help" ? 0 : 2;
+        }
+        const char *value = argv[++a];
+        if(argument=="--output")            options.outputPath = value;
+        else if(argument=="--baseline")     options.baselinePath = value;
+        else if(argument=="--tolerance")    options.tolerance = std::atof(value);
+        else if(argument=="--filter")       options.filter = value;
+        else if(argument=="--repeats")      options.repeats = std::atoi(value);
+        else if(argument=="--threads")      options.threadsNumber = std::atoi(value);
+        else if(argument=="--scale")        options.scale = std::atof(value);
+        else if(argument=="--overlap")      options.overlap = std::atof(value);
+        else if(argument=="--outliers")     options.outliersFraction = std::atof(value);
+        else if(argument=="--seed")         options.seed = std::strtoull(value, nullptr, 10);
+        else{
+            printUsage();
+            return 2;
+        }
+    }
+    const std::map<std::string, double> baseline = options.baselinePath.empty() ? std::map<std::string, double>() : readBaseline(options.baselinePath);
+    static const char *simdLevels[] = {"portable", "avx2", "avx512"};
+    std::ostringstream json;
+    json << "{\"library\":\"simpleClusterization\",\"simdLevel\":\"" << simdLevels[int(simdKernels().level)] << "\",\"threads\":" << options.threadsNumber
+         << ",\"repeats\":" << options.repeats << ",\"overlap\":" << options.overlap << ",\"outliers\":" << options.outliersFraction
+         << ",\"seed\":" << options.seed << ",\"results\":[\n";
+    int regressions = 0;
+    bool first = true;
+    for(const Scenario &scenario : makeScenarios(options)){
+        for(const char *benchmark : {"kmeans", "fcm", "sparseFcm", "fuzzyWeights", "sweep", "predict"}){
+            //The sweep runs every number of clusters up to k, so it's limited to the smaller ones
+            if(std::string(benchmark)=="sweep" && scenario.clustersNumber > 16){
+                continue;
+            }
+            if(scenarioName(benchmark, scenario).find(options.filter)==std::string::npos){
+                continue;
+            }
+            BenchmarkResult result;
+            if(!runIsolated(options, benchmark, scenario, result)){
+                std::fprintf(stderr, "%s: failed\n", result.name.c_str());
+                ++regressions;
+                continue;
+            }
+            const auto baselineEntry = baseline.find(result.name);
+            const double baselineSeconds = baselineEntry==baseline.end() ? 0. : baselineEntry->second;
+            const bool regression = baselineSeconds > 0 && result.seconds > baselineSeconds * (1. + options.tolerance);
+            regressions += regression;
+            std::fprintf(stderr, "%-36s %10.4fs%s\n", result.name.c_str(), result.seconds, regression ? "  REGRESSION" : "");
+            json << (first ? "" : ",\n") << resultJson(result, scenario, baselineSeconds);
+            first = false;
+        }
+    }
+    json << "\n]}\n";
+    if(options.outputPath.empty()){
+        std::fputs(json.str().c_str(), stdout);
+    }else{
+        std::ofstream(options.outputPath) << json.str();
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+///@file simpleClusterization_synthetic.hpp
+///@brief Deterministic synthetic datasets for the benchmarks: gaussian blobs with a controllable overlap and a fraction of uniform outliers
+///@details The random numbers are drawn from the raw output of std::mt19937, which the standard fully specifies, and turned into uniform and normal
+///         variates here rather than by the standard distributions, whose algorithms are left to the implementation.
+///         The same parameters therefore give the same datapoints with every compiler and standard library, so timings stay comparable across machines.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <simpleClusterization_common.hpp>
+
+using namespace Eigen;
+
+///Parameters of makeGaussianBlobs()
+struct SyntheticDatasetOptions{
+    ///The number of datapoints, outliers included
+    int                 entitiesNumber      = 10000;
+    ///The number of dimensions
+    int                 statsNumber         = 16;
+    ///The number of blobs
+    int                 blobsNumber         = 8;
+    ///The typical radius of a blob, in multiples of half the distance between the two closest blob centers: below 1 the blobs are well separated, above it they overlap
+    float               overlap             = 0.5;
+    ///The fraction of the datapoints drawn uniformly over the bounding box of the centers enlarged by half, instead of from a blob
+    float               outliersFraction    = 0.;
+    ///The seed of the random numbers
+    unsigned long long  seed                = 0;
+};
+
+///Turns the raw output of std::mt19937 into uniform and normal variates the same way on every platform
+class SyntheticRandom{
+public:
+    explicit SyntheticRandom(
+            unsigned long long seed
+        ):
+        generator(std::uint32_t(seed ^ (seed >> 32))){
+    }
+
+    ///@return A uniform variate in [0, 1), with the 24 bits of precision of a float
+    float uniform(){
+        return float(generator() >> 8) * (1.f / 16777216.f);
+    }
+
+    ///@return A standard normal variate, from the Box-Muller transform
+    float normal(){
+        if(hasSpare){
+            hasSpare = false;
+            return spare;
+        }
+        //1 - uniform() is in (0, 1], so the logarithm is finite
+        const float radius = std::sqrt(-2.f * std::log(1.f - uniform()));
+        const float angle = 6.28318530718f * uniform();
+        spare = radius * std::sin(angle);
+        hasSpare = true;
+        return radius * std::cos(angle);
+    }
+
+private:
+    std::mt19937    generator;
+    float           spare       = 0;
+    bool            hasSpare    = false;
+};
+
+/*!
+ * @brief       Generates datapoints scattered around blobsNumber centers drawn uniformly in [-1, 1]^d
+ * @details     Datapoint j belongs to blob j % blobsNumber, and its coordinates are those of the center plus a normal variate of standard deviation
+ *              overlap * minSeparation / (2 * sqrt(d)), so that its expected distance from the center is about overlap times half the smallest separation.
+ *              The last outliersFraction of the datapoints are outliers instead
+ * @param[in]   options         The parameters of the dataset
+ * @param[out]  entities        The datapoints, resized to entitiesNumber x statsNumber
+ * @param[out]  centers         The centers of the blobs, resized to blobsNumber x statsNumber
+ * @param[out]  labels          The blob of each datapoint, -1 for the outliers
+*/
+inline void makeGaussianBlobs(
+        const SyntheticDatasetOptions   &options,
+        MatrixXfR                       &entities,
+        MatrixXf                        &centers,
+        VectorXi                        &labels
+    ){
+    const int entitiesNumber = options.entitiesNumber;
+    const int statsNumber = options.statsNumber;
+    const int blobsNumber = options.blobsNumber;
+    SyntheticRandom random(options.seed);
+    centers.resize(blobsNumber, statsNumber);
+    for(int i=0;i<blobsNumber;++i){
+        for(int s=0;s<statsNumber;++s){
+            centers(i, s) = 2.f * random.uniform() - 1.f;
+        }
+    }
+    float minSeparation = blobsNumber > 1 ? std::numeric_limits<float>::infinity() : 2.f;
+    for(int i=0;i<blobsNumber;++i){
+        for(int l=i+1;l<blobsNumber;++l){
+            minSeparation = std::min(minSeparation, (centers.row(i) - centers.row(l)).norm());
+        }
+    }
+    const float deviation = options.overlap * minSeparation / (2.f * std::sqrt(float(statsNumber)));
+    const int outliersNumber = std::min(int(std::lround(options.outliersFraction * float(entitiesNumber))), entitiesNumber);
+    const int blobEntitiesNumber = entitiesNumber - outliersNumber;
+    entities.resize(entitiesNumber, statsNumber);
+    labels.resize(entitiesNumber);
+    for(int j=0;j<blobEntitiesNumber;++j){
+        labels(j) = j % blobsNumber;
+        for(int s=0;s<statsNumber;++s){
+            entities(j, s) = centers(labels(j), s) + deviation * random.normal();
+        }
+    }
+    const RowVectorXf lower = centers.colwise().minCoeff();
+    const RowVectorXf upper = centers.colwise().maxCoeff();
+    for(int j=blobEntitiesNumber;j<entitiesNumber;++j){
+        labels(j) = -1;
+        for(int s=0;s<statsNumber;++s){
+            const float margin = 0.25f * (upper(s) - lower(s));
+            entities(j, s) = lower(s) - margin + (upper(s) - lower(s) + 2.f * margin) * random.uniform();
+        }
+    }
+}
@@ -1,6 +1,10 @@
 #pragma once
 ///@file simpleClusterization.hpp
 ///@brief This is a simple library that provides basic functionality to clusterize data according to either kmeans or fuzzy cmeans algorithms
+///@details The datapoints are the rows of a row-major matrix, MatrixXfR, so that the distance loops read each of them contiguously.
+///         Column-major datapoints, e.g. a MatrixXf, still bind to the Ref<const MatrixXfR> parameters, but through a temporary row-major copy
+///         allocated at every call. The ClusteringContext overloads have column-major variants that convert into a buffer of the context instead,
+///         see the "Column-major overloads" group at the end of this file.
 
 #include <Eigen/Dense>
 #ifndef FCM_MAX_ITERATIONS
@@ -16,6 +20,16 @@
 #endif
 
 #include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_simd.hpp>
+#include <simpleClusterization_threadPool.hpp>
+#include <simpleClusterization_stats.hpp>
+#include <simpleClusterization_fcm.hpp>
+#include <simpleClusterization_sparse.hpp>
+#include <simpleClusterization_context.hpp>
+#include <simpleClusterization_model.hpp>
+#include <simpleClusterization_dataset.hpp>
+#include <random>
 using namespace Eigen;
 
 ///A constant used in offsetting the centroids of one-datapoint clusters in fuzzy-cmeans, to avoid infinite weights
@@ -24,6 +38,115 @@ const float offsetConstant                  = 0.05;
 const int   attemptsPerClustersNumber       = 3;
 ///If empty clusters happen, the algorithm for that number of clusters fails, so we try up to this number of times if this happens.
 const int   maxIterationPerClustersNumber   = 5;
+///The number of datapoints daviesBouldinIndices() sums the distances of as one job, fixed so that the result doesn't depend on the number of threads
+const int   daviesBouldinBlockRows          = 4096;
+
+///The algorithms kmeansGenerator() can use to converge from the initial centroids. All of them produce the same clusterization
+enum class KmeansAlgorithm{
+    ///Hamerly or Elkan depending on the number of clusters if the metric satisfies the triangle inequality, Lloyd otherwise
+    Automatic,
+    ///Recomputes the distance between every datapoint and every centroid at every iteration
+    Lloyd,
+    ///Keeps an upper bound to the distance from the closest centroid and a lower bound to the second closest for each datapoint
+    Hamerly,
+    ///Keeps an upper bound to the distance from the closest centroid and a lower bound to every other centroid for each datapoint, O(n*k) memory
+    Elkan
+};
+
+///KmeansAlgorithm::Automatic picks Hamerly up to this number of clusters, and Elkan above it
+const int   hamerlyMaxClustersNumber        = 16;
+
+///The strategies kmeansGenerator() can use to choose the initial centroids, see simpleClusterization_initializers.hpp
+enum class KmeansInitialization{
+    ///kmeans++, k sequential passes over the datapoints
+    KmeansPlusPlus,
+    ///Scalable kmeans++ (kmeans||), a few oversampling passes over the datapoints followed by kmeans++ on the sampled centers, suited for large datasets
+    KmeansParallel,
+    ///The centroids passed to kmeansGenerator() are used as they are, to start from a known solution
+    Provided
+};
+
+///Parameters of kmeansGenerator()
+struct KmeansOptions{
+    ///The algorithm used to converge. Hamerly and Elkan fall back to Lloyd for metrics that don't satisfy the triangle inequality (see MetricTraits)
+    KmeansAlgorithm         algorithm           = KmeansAlgorithm::Automatic;
+    ///The strategy used to choose the initial centroids
+    KmeansInitialization    initialization      = KmeansInitialization::KmeansPlusPlus;
+    ///With KmeansInitialization::KmeansParallel, the expected number of centers sampled per round, in multiples of the number of clusters
+    float                   oversamplingFactor  = 2.;
+    ///With KmeansInitialization::KmeansParallel, the number of sampling rounds
+    int                     parallelRounds      = 5;
+};
+
+///Parameters of streamingKmeansGenerator() and streamingCalculateLabels()
+struct StreamingKmeansOptions{
+    ///The maximum number of datapoints read at a time, the memory used is bounded by chunkSize x d plus a few k x d buffers
+    int                     chunkSize           = 8192;
+    ///The maximum number of passes over the dataset
+    int                     maxPasses           = 10;
+    ///The run stops when a whole pass moves the centroids by less than this, as a squared norm relative to the squared norm of the centroids
+    float                   tolerance           = 1.0E-6;
+    ///The seeding, drawn from the first chunk. Its algorithm is ignored, the centroids are updated by mini-batches
+    KmeansOptions           kmeans;
+};
+
+///The ways silhouetteTest() can compute the silhouette, see simpleClusterization_silhouette.hpp
+enum class SilhouetteMode{
+    ///The silhouette of every datapoint against every other one, O(n^2) distances spread over a thread pool
+    Exact,
+    ///The distances to the datapoints of each cluster are replaced by the distance to its centroid, O(n*k) distances
+    Simplified,
+    ///The exact silhouette of a random sample of the datapoints, O(sampleSize^2) distances
+    Sampled
+};
+
+///Parameters of silhouetteTest()
+struct SilhouetteOptions{
+    ///How the silhouette is computed
+    SilhouetteMode      mode            = SilhouetteMode::Exact;
+    ///With SilhouetteMode::Sampled, the number of datapoints drawn. If it's not lower than the number of datapoints, the silhouette is exact
+    int                 sampleSize      = 2000;
+    ///With SilhouetteMode::Sampled, the seed the sample is drawn from
+    unsigned long long  seed            = 0;
+    ///With SilhouetteMode::Exact and SilhouetteMode::Sampled, the number of threads, 0 means one per hardware thread. Ignored if threadPool is set
+    int                 threadsNumber   = 1;
+    ///A pool to run on, so that repeated calls don't spawn new threads. If null, a pool of threadsNumber threads is created for the call
+    ThreadPool          *threadPool     = nullptr;
+};
+
+///Parameters of FCMGenerator()
+struct FcmOptions{
+    ///If true, the first weights are computed from the centroids passed in instead of being random
+    bool                initializeFromCentroids = false;
+    ///The fuzziness exponent m, greater than 1. The closer to 1, the closer the memberships get to hard assignments
+    float               fuzziness               = 2.;
+    ///The maximum number of iterations to do if the algorithm doesn't otherwise converge
+    int                 maxIterations           = FCM_MAX_ITERATIONS;
+    ///The algorithm has converged when the squared norm of the change of the weights in an iteration is not above this
+    float               tolerance               = FCM_THRESHOLD;
+    ///The seed the random first weights are drawn from, so that a run is reproducible
+    unsigned long long  seed                    = 0;
+};
+
+///Parameters of the sweep over the number of clusters done by clusterGeneratorApproximate()
+struct SweepOptions{
+    ///The parameters of every kmeansGenerator() run of the sweep
+    KmeansOptions       kmeans;
+    ///The number of threads the (clusters number, attempt) jobs are spread over, 0 means one per hardware thread. Ignored if threadPool is set
+    int                 threadsNumber   = 1;
+    ///A pool to run the jobs on, so that repeated calls don't spawn new threads. If null, a pool of threadsNumber threads is created for the call
+    ThreadPool          *threadPool     = nullptr;
+    ///Every job draws its random numbers from its own stream derived from this seed, so the result doesn't depend on the number of threads
+    unsigned long long  seed            = 0;
+    ///If true, the numbers of clusters are visited in increasing order and each one starts from the best solution of the previous one plus one centroid,
+    ///instead of a fresh seeding, so each run only needs a few iterations to converge. Only the attempts of the same number of clusters run in parallel
+    bool                warmStart       = false;
+    ///The parameters of the silhouette clusterGeneratorExact() ranks the numbers of clusters with. If it has no thread pool, the one of the sweep is used
+    SilhouetteOptions   silhouette;
+    ///The parameters of every FCMGenerator() run of clusterGeneratorExact(), initializeFromCentroids is set by warmStart and the seed is derived from seed
+    FcmOptions          fcm;
+};
+
 
 
 
@@ -37,7 +160,7 @@ const int   maxIterationPerClustersNumber   = 5;
  * @param[in]   norm        A pointer to the norm function you want to use
 */
 void calculateFuzzyWeights(
-        const Ref<const MatrixXf>   &entities,
+        const Ref<const MatrixXfR>  &entities,
         const Ref<const MatrixXf>   &centroids,
         Ref<MatrixXfR>              weights,
         squaredNorm_t               *norm
@@ -51,7 +174,7 @@ void calculateFuzzyWeights(
  * @param[in]       norm        A pointer to the norm function you want to use
 */
 void FCMGenerator(
-        const Ref<const MatrixXf>   &entities, 
+        const Ref<const MatrixXfR>  &entities, 
         Ref<MatrixXf>               centroids, 
         Ref<MatrixXfR>              weights, 
         squaredNorm_t               *norm
@@ -72,23 +195,25 @@ void FCMGenerator(
  * @return     The Davies-Boulding index of the provided clusterization
 */ 
 float daviesBouldinIndex(
-        const Ref<const MatrixXf>    &entities,
+        const Ref<const MatrixXfR>   &entities,
         const Ref<const MatrixXf>    &centroids,
         const Ref<const MatrixXb>    &weights,
         squaredNorm_t                *norm
     );
 
 /*!
- * @brief Returns a measure of how well the clusters fit the data
- * @warning TODO <b>Not implemented</b>
+ * @brief Returns a measure of how well the clusters fit the data, between -1 and 1, the higher the better
+ * @details     This is the fuzzy silhouette of Campello and Hruschka: every datapoint is assigned to the cluster with its highest weight, and the
+ *              average of the silhouettes of the datapoints is weighted by the difference between their two highest weights.
+ *              The silhouette is computed exactly, see the SilhouetteOptions overload for cheaper approximations
  * @param[in]   entities     The datapoints
  * @param[in]   clusters     The centroids of the clusters
- * @param[out]  weights      The weights associating each centroid to its cluster (it's an array of floats)
+ * @param[in]   weights      The weights associating each centroid to its cluster (it's an array of floats)
  * @param[in]   norm         A pointer to the norm function you want to use
  * @return     the fitness of the clusterization
 */
 float silhouetteTest(
-        const Ref<const MatrixXf>   &entities, 
+        const Ref<const MatrixXfR>  &entities, 
         const Ref<const MatrixXf>   &clusters,
         const Ref<const MatrixXfR>  &weights,
         squaredNorm_t               *norm
@@ -102,12 +227,34 @@ float silhouetteTest(
  * @param[in]   norm        A pointer to the norm function you want to use
 */
 void calculateBooleanWeights(
-        const Ref<const MatrixXf>   &entities,
+        const Ref<const MatrixXfR>  &entities,
         const Ref<const MatrixXf>   &centroids,
         Ref<MatrixXbR>              weights,
         squaredNorm_t               *norm
     );
 
+/*!
+ * @brief       Converts hard assignments from one cluster index per datapoint to the k x n boolean weights matrix
+ * @param[in]   labels      The index of the cluster of each datapoint, negative labels leave the datapoint unassigned
+ * @param[out]  weights     The weights associating each centroid to its cluster (it's an array of bools)
+*/
+void labelsToBooleanWeights(
+        const Ref<const VectorXi>   &labels,
+        Ref<MatrixXbR>              weights
+    );
+
+/*!
+ * @brief       Converts hard assignments from the k x n boolean weights matrix to one cluster index per datapoint
+ * @param[in]   weights     The weights associating each centroid to its cluster (it's an array of bools)
+ * @param[out]  labels      The index of the cluster of each datapoint, -1 for datapoints not assigned to any cluster
+ * @param[out]  counts      The number of datapoints in each cluster
+*/
+void booleanWeightsToLabels(
+        const Ref<const MatrixXbR>  &weights,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts
+    );
+
 /*!
  * @brief       Given a dataset and a centroids matrix of k rows, it tries to identify the most probable k centroids to represent the dataset
  * @param[in]   entities    The datapoints
@@ -116,7 +263,7 @@ void calculateBooleanWeights(
  * @param[in]   norm        A pointer to the norm function you want to use
 */
 void kmeansGenerator(
-        const Ref<const MatrixXf>   &entities,
+        const Ref<const MatrixXfR>  &entities,
         Ref<MatrixXf>               centroids,
         Ref<MatrixXbR>              weights,
         squaredNorm_t               *norm
@@ -132,7 +279,7 @@ void kmeansGenerator(
  * @return     the number of clusters generated
 */ 
 int clusterGeneratorApproximate(
-        const Ref<const MatrixXf>   &entities,
+        const Ref<const MatrixXfR>  &entities,
         Ref<MatrixXf>               centroids,
         Ref<MatrixXfR>              weights,
         Ref<MatrixXbR>              boolWeights,
@@ -148,9 +295,724 @@ int clusterGeneratorApproximate(
  * @return     the number of clusters generated
 */ 
 int clusterGeneratorExact(
-        const Ref<const MatrixXf>   &entities,
+        const Ref<const MatrixXfR>  &entities,
         Ref<MatrixXf>               centroids,
         MatrixXfR                   &weights, 
         squaredNorm_t               *norm
     );
 
+/*!
+ * @name        Compile-time metric overloads
+ * @brief       Each of the following behaves as the homonymous function above, but takes a metric functor instead of a squaredNorm_t pointer.
+ * @details     The functor is called directly on the rows of the matrices, so no temporary vector is allocated and the distance can be inlined.
+ *              See simpleClusterization_metrics.hpp for the metrics shipped with the library.
+ *              The function pointer overloads are thin adapters around these.
+ *              Column-major datapoints are copied to row-major at every call of those without a ClusteringContext, see the column-major overloads below.
+*/
+///@{
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric
+        );
+
+/*!
+ * @brief       Same as calculateFuzzyWeights() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        );
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as FCMGenerator() above, with the parameters of the run given through options
+ * @param[in-out] centroids     The centroids of the clusters, read as the starting point if options.initializeFromCentroids is set
+ * @param[in]   options         The parameters of the run
+*/
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options
+    );
+
+/*!
+ * @brief       Same as FCMGenerator() above, running on the buffers of a caller-provided workspace so that repeated runs don't allocate
+ * @param[in]   workspace   The scratch buffers, resized as needed and kept for the next call
+*/
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        FcmWorkspace                &workspace
+    );
+
+/*!
+ * @brief       Same as FCMGenerator() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const MatrixXbR>   &weights,
+        const Metric                 &metric
+    );
+
+/*!
+ * @brief       Same as daviesBouldinIndex() above, with hard assignments given as one cluster index per datapoint, so the scatter is computed in a single O(n) pass
+ * @param[in]   labels      The index of the cluster of each datapoint
+ * @param[in]   counts      The number of datapoints in each cluster
+*/
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric
+    );
+
+/*!
+ * @brief       Same as daviesBouldinIndex() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        ClusteringContext            &context
+    );
+
+/*!
+ * @brief       Computes the Davies-Bouldin index of several hard clusterizations of the same datapoints, e.g. the candidates of a sweep over the number of clusters,
+ *              going over the datapoints once for all of them
+ * @details     Each datapoint is compared to its centroid in every clusterization while it's in cache. Only the pairs of distinct centroids of a clusterization
+ *              are then visited once each, see daviesBouldinIndex() above for the definition
+ * @param[in]   entities        The datapoints
+ * @param[in]   centroids       The centroids of all the clusterizations, stacked in the order of clustersNumbers
+ * @param[in]   clustersNumbers The number of clusters of each clusterization
+ * @param[in]   labels          The index of the cluster of each datapoint within each clusterization, one column per clusterization
+ * @param[in]   metric          The metric functor you want to use
+ * @param[out]  indices         The Davies-Bouldin index of each clusterization, NaN if it has an empty cluster
+*/
+template<typename Metric>
+void daviesBouldinIndices(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices
+    );
+
+/*!
+ * @brief       Same as daviesBouldinIndices() above, spreading the datapoints over the thread pool of a context and running on its scratch buffers
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+void daviesBouldinIndices(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices,
+        ClusteringContext           &context
+    );
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric
+        );
+
+/*!
+ * @brief       Same as silhouetteTest() above, with the way the silhouette is computed chosen through options
+ * @param[in]   options     The mode, sampling and threading parameters
+*/
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options
+        );
+
+/*!
+ * @brief       Same as silhouetteTest() above, running on the scratch buffers and thread pool of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        );
+
+/*!
+ * @brief       Same as silhouetteTest() above, for hard assignments given as one cluster index per datapoint, the plain average of the silhouettes
+ * @param[in]   labels      The index of the cluster of each datapoint
+*/
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options = SilhouetteOptions()
+        );
+
+/*!
+ * @brief       Same as silhouetteTest() above, running on the scratch buffers and thread pool of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        );
+
+template<typename Metric>
+void calculateBooleanWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as calculateBooleanWeights(), but writes the index of the closest centroid to each datapoint instead of a k x n matrix
+ * @param[in]   entities    The datapoints
+ * @param[in]   centroids   The centroids of the clusters
+ * @param[in-out] labels    The index of the closest centroid to each datapoint
+ * @param[in]   metric      The metric functor you want to use
+ * @return      The number of labels that changed, used to detect convergence
+*/
+template<typename Metric>
+int calculateLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as calculateLabels() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+int calculateLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        ClusteringContext           &context
+    );
+
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as kmeansGenerator() above, but draws the kmeans++ seeding from the provided generator instead of a std::random_device
+ * @param[in]   generator   The random numbers generator, the result is reproducible given its state
+*/
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric,
+        std::mt19937                &generator
+    );
+
+/*!
+ * @brief       Same as kmeansGenerator() above, with the algorithm used to converge chosen through options
+ * @param[in]   generator   The random numbers generator, the result is reproducible given its state
+ * @param[in]   options     The parameters of the run
+*/
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options
+    );
+
+/*!
+ * @brief       Same as kmeansGenerator() above, with hard assignments given as one cluster index per datapoint plus the clusters' populations
+ * @details     This is the representation the algorithms work on, centroids are updated with a single accumulation pass and convergence is detected
+ *              when no label changes. The boolean weights overloads convert from it.
+ * @param[out]  labels      The index of the cluster of each datapoint
+ * @param[out]  counts      The number of datapoints in each cluster
+*/
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options = KmeansOptions()
+    );
+
+/*!
+ * @brief       Same as kmeansGenerator() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options,
+        ClusteringContext           &context
+    );
+
+/*!
+ * @brief       Mini-batch k-means on datapoints read one chunk at a time, for datasets that don't fit in memory, see simpleClusterization_streaming.hpp
+ * @details     The source is called as source(chunk), where chunk is a Ref<MatrixXfR> of options.chunkSize rows and d columns: it fills the first rows of chunk
+ *              with the next datapoints and returns how many it wrote, or 0 at the end of the dataset, after which the following call starts over from
+ *              the first datapoint. Only the current chunk and a few k x d buffers are held in memory, whatever the number of datapoints.
+ *              Run streamingCalculateLabels() afterwards for the final assignment of the datapoints
+ * @param[in]   source      The source of the datapoints
+ * @param[in-out] centroids The centroids of the clusters, read as the starting point with KmeansInitialization::Provided. Its number of columns is d
+ * @param[out]  counts      The number of datapoints in each cluster during the last pass
+ * @param[in]   metric      The metric functor you want to use
+ * @param[in]   generator   The random numbers generator the seeding is drawn from
+ * @param[in]   options     The parameters of the run
+ * @return      The number of passes done over the dataset
+*/
+template<typename Metric, typename ChunkSource>
+int streamingKmeansGenerator(
+        ChunkSource                     &&source,
+        Ref<MatrixXf>                   centroids,
+        Ref<VectorXi>                   counts,
+        const Metric                    &metric,
+        std::mt19937                    &generator,
+        const StreamingKmeansOptions    &options = StreamingKmeansOptions()
+    );
+
+/*!
+ * @brief       Same as streamingKmeansGenerator() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric, typename ChunkSource>
+int streamingKmeansGenerator(
+        ChunkSource                     &&source,
+        Ref<MatrixXf>                   centroids,
+        Ref<VectorXi>                   counts,
+        const Metric                    &metric,
+        std::mt19937                    &generator,
+        const StreamingKmeansOptions    &options,
+        ClusteringContext               &context
+    );
+
+/*!
+ * @brief       Assigns every datapoint of a source (see streamingKmeansGenerator()) to its closest centroid, handing the labels out one chunk at a time
+ * @param[in]   source      The source of the datapoints, read once from the first datapoint to the end
+ * @param[in]   centroids   The centroids of the clusters
+ * @param[in]   metric      The metric functor you want to use
+ * @param[in]   labelsSink  Called as labelsSink(firstEntity, labels) for every chunk, where labels is a const Ref<const VectorXi>& holding the index
+ *                          of the closest centroid to the datapoints firstEntity, firstEntity + 1, ... of the dataset
+ * @param[in]   options     Only the chunkSize is read
+ * @return      The number of datapoints
+*/
+template<typename Metric, typename ChunkSource, typename LabelsSink>
+Index streamingCalculateLabels(
+        ChunkSource                     &&source,
+        const Ref<const MatrixXf>       &centroids,
+        const Metric                    &metric,
+        LabelsSink                      &&labelsSink,
+        const StreamingKmeansOptions    &options = StreamingKmeansOptions()
+    );
+
+/*!
+ * @brief       Same as streamingCalculateLabels() above, running on the scratch buffers of a context, so that repeated calls don't allocate
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric, typename ChunkSource, typename LabelsSink>
+Index streamingCalculateLabels(
+        ChunkSource                     &&source,
+        const Ref<const MatrixXf>       &centroids,
+        const Metric                    &metric,
+        LabelsSink                      &&labelsSink,
+        const StreamingKmeansOptions    &options,
+        ClusteringContext               &context
+    );
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<MatrixXbR>              boolWeights,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorApproximate() above, with the (clusters number, attempt) runs spread over a thread pool
+ * @details     The runs are independent, each one owns its scratch buffers and random numbers stream, and ties between equally fit runs are resolved
+ *              in favour of the one a serial sweep would meet first, so the result only depends on options.seed
+ * @param[in]   options     The threading and seeding parameters of the sweep
+*/
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<MatrixXbR>              boolWeights,
+        const Metric                &metric,
+        const SweepOptions          &options
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorApproximate() above, with the hard assignments given as one cluster index per datapoint
+ * @param[out]  labels      The index of the cluster of each datapoint
+*/
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorApproximate() above, running on the scratch buffers and thread pool of a context, so that repeated calls don't allocate
+ * @param[in]   options     The parameters of the sweep, its threading ones are replaced by the context's
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorExact() above, with the seeding and warm start of the sweep given through options
+ * @details     With options.warmStart, each number of clusters starts from the centroids of the previous one plus a kmeans++ center.
+ *              The runs are sequential, the thread pool is only used by the silhouette
+ * @param[in]   options     The seeding, silhouette and threading parameters of the sweep
+*/
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorExact() above, running on the scratch buffers and thread pool of a context, so that repeated calls don't allocate
+ * @param[in]   options     The parameters of the sweep, its threading ones are replaced by the context's
+ * @param[in]   context     The context, see simpleClusterization_context.hpp
+*/
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+///@}
+
+/*!
+ * @name        Sparse memberships overloads
+ * @brief       Each of the following behaves as the homonymous function above, but only keeps the memberships of the m closest centroids of each datapoint,
+ *              renormalized, see simpleClusterization_sparse.hpp. m is the number of columns of the SparseMemberships, which must have one row per datapoint
+*/
+///@{
+/*!
+ * @brief       Computes the weights of calculateFuzzyWeights() for the closest centroids of each datapoint, normalized so that they sum up to 1
+ * @param[out]  weights     The memberships
+*/
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric
+        );
+
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        );
+
+/*!
+ * @brief       Fuzzy c-means where each datapoint only belongs to its closest centroids, and the centroids are updated from those memberships only
+ * @param[out]  weights     The memberships, initialized at random over m consecutive clusters unless options.initializeFromCentroids is set
+*/
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options
+    );
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        FcmWorkspace                &workspace
+    );
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    );
+
+/*!
+ * @brief       Same as clusterGeneratorApproximate(), with the fuzzy weights of the result kept for the closest centroids of each datapoint only
+ * @param[out]  weights     The memberships to the clusters found
+*/
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options
+    );
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+///@}
+
+/*!
+ * @name        Column-major overloads
+ * @brief       Each of the following behaves as the homonymous ClusteringContext overload above, for datapoints stored column-major, e.g. a MatrixXf.
+ * @details     The datapoints are converted once per call to row-major in a buffer of the context, see ClusteringContext::rowMajorEntities(),
+ *              so once the context has served a call the following ones on as many datapoints don't allocate. Row-major datapoints don't pick these overloads
+*/
+///@{
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void calculateFuzzyWeights(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void FCMGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+float daviesBouldinIndex(
+        const MatrixBase<Derived>    &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        ClusteringContext            &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void daviesBouldinIndices(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+float silhouetteTest(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+float silhouetteTest(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+int calculateLabels(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void kmeansGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+int clusterGeneratorApproximate(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+int clusterGeneratorExact(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void calculateFuzzyWeights(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+void FCMGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    );
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+int clusterGeneratorApproximate(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    );
+///@}
+
+#include <simpleClusterization_impl.hpp>
@@ -4,18 +4,99 @@
 ///@brief common definitions that users of the library might need independently from the rest of the files 
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 using namespace Eigen;
 
 ///Shorthand type for a RowMajor Matrix of floats
 typedef Matrix<float, Dynamic, Dynamic, RowMajor>   MatrixXfR;
+///Shorthand type for a RowMajor Matrix of ints
+typedef Matrix<int, Dynamic, Dynamic, RowMajor>     MatrixXiR;
 ///Shorthand type for a ColMajor Matrix of bools
 typedef Matrix<bool, Dynamic, Dynamic>              MatrixXb;
 ///Shorthand type for a RowMajor Matrix of bools
 typedef Matrix<bool, Dynamic, Dynamic, RowMajor>    MatrixXbR;
 
+///Enables the overloads that take column-major datapoints, see ClusteringContext::rowMajorEntities(). Row-major ones bind to Ref<const MatrixXfR> without a copy
+template<typename Derived>
+using EnableIfColumnMajor = typename std::enable_if<!(int(Derived::Flags) & RowMajorBit), int>::type;
+
 ///The type signature for the norm parameters of the functions in this library
 typedef float squaredNorm_t(const VectorXf &v1, const VectorXf &v2);
 
 ///A basic example of norm that satisfies the type signature
 float euclideanNorm(const VectorXf &v1, const VectorXf &v2);
+
+/*!
+ * @brief       Returns a rows x cols view over a buffer, growing the buffer if it's too small but never shrinking it,
+ *              so that a buffer reused for problems of varying sizes only allocates for the largest one
+ * @param[in-out] storage   The buffer
+ * @param[in]   rows        The number of rows of the view
+ * @param[in]   cols        The number of columns of the view
+ * @return      The view, valid until the buffer is grown again
+*/
+template<typename MatrixType>
+Map<MatrixType> storageView(
+        Matrix<typename MatrixType::Scalar, Dynamic, 1>     &storage,
+        Index                                               rows,
+        Index                                               cols
+    ){
+    if(storage.size() < rows * cols){
+        storage.resize(rows * cols);
+    }
+    return Map<MatrixType>(storage.data(), rows, cols);
+}
+
+/*!
+ * @brief       Same as std::seed_seq over a fixed number of values, so that seeding the random numbers generator of a job doesn't allocate.
+ *              It generates the same sequence as std::seed_seq given the same values
+*/
+template<int valuesNumber>
+struct FixedSeedSequence{
+    typedef std::uint32_t result_type;
+
+    ///The values the sequence is generated from
+    std::uint32_t values[valuesNumber];
+
+    template<typename Iterator>
+    void generate(
+            Iterator    begin,
+            Iterator    end
+        ) const{
+        const std::size_t n = end - begin;
+        if(n==0){
+            return;
+        }
+        auto tempering = [](std::uint32_t x){
+            return x ^ (x >> 27);
+        };
+        std::fill(begin, end, std::uint32_t(0x8b8b8b8b));
+        const std::size_t t = n >= 623 ? 11 : n >= 68 ? 7 : n >= 39 ? 5 : n >= 7 ? 3 : (n - 1) / 2;
+        const std::size_t p = (n - t) / 2;
+        const std::size_t q = p + t;
+        const std::size_t m = std::max<std::size_t>(valuesNumber + 1, n);
+        for(std::size_t k=0;k<m;++k){
+            const std::uint32_t r1 = 1664525u * tempering(begin[k % n] ^ begin[(k + p) % n] ^ begin[(k + n - 1) % n]);
+            std::uint32_t r2 = r1;
+            if(k==0){
+                r2 += valuesNumber;
+            }else if(k <= valuesNumber){
+                r2 += std::uint32_t(k % n) + values[k - 1];
+            }else{
+                r2 += std::uint32_t(k % n);
+            }
+            begin[(k + p) % n] += r1;
+            begin[(k + q) % n] += r2;
+            begin[k % n] = r2;
+        }
+        for(std::size_t k=m;k<m + n;++k){
+            const std::uint32_t r3 = 1566083941u * tempering(begin[k % n] + begin[(k + p) % n] + begin[(k + n - 1) % n]);
+            const std::uint32_t r4 = r3 - std::uint32_t(k % n);
+            begin[(k + p) % n] ^= r3;
+            begin[(k + q) % n] ^= r4;
+            begin[k % n] = r4;
+        }
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+///@file simpleClusterization_context.hpp
+///@brief Reusable scratch memory and threads for the functions of the library
+///@details Every function of simpleClusterization.hpp has an overload taking a ClusteringContext. The context keeps all the buffers the call needs,
+///         and they're only grown (see storageView()), so once a context has served a call, the following calls on data of the same or smaller sizes
+///         don't allocate any memory. A context must not be used by two calls at the same time.
+///         Column-major datapoints are converted once per call into a buffer of the context, see rowMajorEntities().
+///         A ClusteringStats attached with setStats() measures the calls made with the context.
+
+#include <Eigen/Dense>
+#include <memory>
+#include <vector>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_stats.hpp>
+#include <simpleClusterization_threadPool.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_kmeans.hpp>
+#include <simpleClusterization_fcm.hpp>
+#include <simpleClusterization_silhouette.hpp>
+#include <simpleClusterization_streaming.hpp>
+
+using namespace Eigen;
+
+///The buffers of a worker of the clusterGeneratorApproximate() sweep: the run it's doing and the best one it has seen so far
+struct SweepWorkspace{
+    ///The scratch buffers of the kmeansGenerator() runs
+    KmeansWorkspace     kmeans;
+    VectorXf            currentClusters;
+    VectorXi            currentLabels;
+    VectorXi            currentCounts;
+    float               currentFitness      = 50.;
+    VectorXf            bestClusters;
+    VectorXi            bestLabels;
+    VectorXi            bestCounts;
+    float               bestFitness         = 50.;
+    int                 bestJob             = -1;
+    int                 bestClustersNumber  = 2;
+
+    ///Grows the buffers to the sizes a sweep on entitiesNumber datapoints of statsNumber dimensions up to clustersNumber clusters needs, see KmeansWorkspace::reserve()
+    void reserve(
+            int     entitiesNumber,
+            int     statsNumber,
+            int     clustersNumber,
+            int     candidatesNumber,
+            bool    seeded,
+            int     lowerBoundsNumber
+        ){
+        kmeans.reserve(entitiesNumber, statsNumber, clustersNumber, candidatesNumber, seeded, lowerBoundsNumber);
+        storageView<VectorXf>(currentClusters, clustersNumber * statsNumber, 1);
+        storageView<VectorXi>(currentLabels, entitiesNumber, 1);
+        storageView<VectorXi>(currentCounts, clustersNumber, 1);
+        storageView<VectorXf>(bestClusters, clustersNumber * statsNumber, 1);
+        storageView<VectorXi>(bestLabels, entitiesNumber, 1);
+        storageView<VectorXi>(bestCounts, clustersNumber, 1);
+    }
+};
+
+/*!
+ * @brief   The scratch memory and thread pool the library functions run on, meant to be reused across calls
+ * @note    The buffers are public so that the library functions can share them, they're not meant to be used by callers
+*/
+class ClusteringContext{
+public:
+    ///@param[in]   threadsNumber   The number of workers of the context's own thread pool, including the calling thread. 0 means one per hardware thread
+    explicit ClusteringContext(
+            int         threadsNumber = 1
+        ):
+        ownThreadPool(new ThreadPool(threadsNumber)),
+        pool(ownThreadPool.get()),
+        sweepWorkspaces(pool->size()){
+    }
+
+    ///@param[in]   threadPool      An external thread pool, which must outlive the context
+    explicit ClusteringContext(
+            ThreadPool  &threadPool
+        ):
+        pool(&threadPool),
+        sweepWorkspaces(pool->size()){
+    }
+
+    /*!
+     * @brief       Creates the context a function without one runs on
+     * @param[in]   threadPool      An external thread pool, or nullptr to give the context its own
+     * @param[in]   threadsNumber   The number of workers of the context's own thread pool, ignored if threadPool is set
+    */
+    static std::unique_ptr<ClusteringContext> create(
+            ThreadPool  *threadPool,
+            int         threadsNumber
+        ){
+        return std::unique_ptr<ClusteringContext>(threadPool ? new ClusteringContext(*threadPool) : new ClusteringContext(threadsNumber));
+    }
+
+    ClusteringContext(const ClusteringContext&) = delete;
+    ClusteringContext& operator=(const ClusteringContext&) = delete;
+
+    ///@return The thread pool the functions spread their work over
+    ThreadPool &threadPool(){
+        return *pool;
+    }
+
+    /*!
+     * @brief       Attaches the statistics the following calls report to, see simpleClusterization_stats.hpp
+     * @param[in]   stats   The statistics, which must outlive their use by the context, or nullptr to stop measuring
+    */
+    void setStats(
+            ClusteringStats *stats
+        ){
+        attachedStats = stats;
+        for(SweepWorkspace &workspace : sweepWorkspaces){
+            workspace.kmeans.stats = stats;
+        }
+        for(SweepWorkspace &workspace : attemptsWorkspaces){
+            workspace.kmeans.stats = stats;
+        }
+        fcm.stats = stats;
+        streaming.kmeans.stats = stats;
+    }
+
+    ///@return The statistics attached to the context, nullptr if there are none
+    ClusteringStats *stats() const{
+        return attachedStats;
+    }
+
+    /*!
+     * @brief       Copies column-major datapoints to the row-major layout the library works on, into a buffer of the context
+     * @details     This is what the column-major overloads of the library functions run on, so that they convert the datapoints once per call
+     *              without allocating, where binding them to a Ref<const MatrixXfR> would allocate a temporary copy at every call
+     * @param[in]   entities    The datapoints
+     * @return      The copy, valid until the next call
+    */
+    template<typename Derived>
+    Map<const MatrixXfR> rowMajorEntities(
+            const MatrixBase<Derived>   &entities
+        ){
+        auto copy = storageView<MatrixXfR>(rowMajorEntitiesStorage, entities.rows(), entities.cols());
+        copy = entities;
+        return Map<const MatrixXfR>(copy.data(), copy.rows(), copy.cols());
+    }
+
+private:
+    std::unique_ptr<ThreadPool>     ownThreadPool;
+    ThreadPool                      *pool;
+    ClusteringStats                 *attachedStats = nullptr;
+
+public:
+    ///The row-major copy of the datapoints of the column-major overloads, see rowMajorEntities()
+    VectorXf                        rowMajorEntitiesStorage;
+    ///The squared norms of the datapoints of the current call
+    VectorXf                        entitiesSquaredNorms;
+    ///One per worker of the thread pool, the first one also serves the functions that don't use the pool
+    std::vector<SweepWorkspace>     sweepWorkspaces;
+    ///One per attempt of a warm-started sweep
+    std::vector<SweepWorkspace>     attemptsWorkspaces;
+    ///The solution a warm-started sweep starts the next number of clusters from, and its per-datapoint and per-cluster distances
+    VectorXf                        baseClusters;
+    VectorXi                        baseLabels;
+    VectorXf                        nearestDistances;
+    VectorXf                        clustersScatter;
+    VectorXf                        splitOffset;
+    ///The number of datapoints in each cluster of the result
+    VectorXi                        counts;
+    ///The per-cluster distance sums and counts of each block of datapoints of daviesBouldinIndices()
+    VectorXf                        blocksScatter;
+    VectorXi                        blocksCounts;
+    ///The average datapoint
+    VectorXf                        averageEntity;
+    ///The candidate centroids and weights of clusterGeneratorExact()
+    VectorXf                        exactClusters;
+    VectorXf                        exactWeights;
+    ///The scratch buffers of FCMGenerator()
+    FcmWorkspace                    fcm;
+    ///The scratch buffers of silhouetteTest()
+    SilhouetteWorkspace             silhouette;
+    ///The scratch buffers of streamingKmeansGenerator() and streamingCalculateLabels()
+    StreamingWorkspace              streaming;
+};
@@ -0,0 +1,148 @@
+#pragma once
+///@file simpleClusterization_dataset.hpp
+///@brief A binary file format for datasets, centroids and labels, loaded through a read-only memory mapping so that no copy is made
+///@details A file is a 64 bytes DatasetHeader followed by the rows x cols values of the payload, in the machine's byte order.
+///         The mapping is shared, so processes reading the same file share its pages in the page cache, and loading is immediate
+///         whatever the size of the file: pages are only read from the disk when the clusterization first touches them.
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <string>
+#include <simpleClusterization_common.hpp>
+
+using namespace Eigen;
+
+///The types of the values of a dataset file
+enum class DatasetType : std::uint32_t{
+    ///32 bits floats, for datapoints and centroids
+    Float32     = 0,
+    ///32 bits signed integers, for labels
+    Int32       = 1
+};
+
+///The order of the values of a dataset file
+enum class DatasetLayout : std::uint32_t{
+    ///One row after the other, a datapoint's values are contiguous
+    RowMajor    = 0,
+    ///One column after the other, as MatrixXf stores them
+    ColumnMajor = 1
+};
+
+///The header at the start of a dataset file, padded to 64 bytes so that the payload is aligned for vectorized loads
+struct DatasetHeader{
+    ///Always "SCLDATA" followed by a null byte
+    char            magic[8];
+    ///The version of the format, datasetFormatVersion
+    std::uint32_t   version;
+    ///A DatasetType
+    std::uint32_t   type;
+    ///A DatasetLayout
+    std::uint32_t   layout;
+    std::uint32_t   reserved;
+    ///The number of rows and columns of the payload
+    std::uint64_t   rows;
+    std::uint64_t   cols;
+    std::uint8_t    padding[24];
+};
+static_assert(sizeof(DatasetHeader)==64, "DatasetHeader must be 64 bytes long");
+
+///The version of the format written by writeDataset()
+const std::uint32_t datasetFormatVersion = 1;
+
+/*!
+ * @brief   A dataset file mapped in memory, whose payload is exposed as Eigen maps pointing straight into the mapping
+ * @details The maps stay valid as long as the object is alive and open. The entities of a RowMajor file bind directly to the
+ *          const Ref<const MatrixXfR>& parameters of the library, or can be read in chunks through chunkSource()
+*/
+class MappedDataset{
+public:
+    MappedDataset() = default;
+    ~MappedDataset();
+    MappedDataset(const MappedDataset&) = delete;
+    MappedDataset& operator=(const MappedDataset&) = delete;
+
+    /*!
+     * @brief       Maps a dataset file, closing the one currently mapped if any
+     * @param[in]   path    The path of the file
+     * @return      false if the file can't be mapped or isn't a valid dataset file
+    */
+    bool open(const std::string &path);
+    ///Unmaps the file, invalidating the maps handed out
+    void close();
+
+    ///@return whether a file is mapped
+    bool isOpen() const{
+        return mapping!=nullptr;
+    }
+    ///@return The header of the mapped file
+    const DatasetHeader &header() const{
+        return *static_cast<const DatasetHeader*>(mapping);
+    }
+    ///@return The number of rows of the payload, the datapoints
+    Index rows() const{
+        return Index(header().rows);
+    }
+    ///@return The number of columns of the payload, the dimensions
+    Index cols() const{
+        return Index(header().cols);
+    }
+    DatasetType type() const{
+        return DatasetType(header().type);
+    }
+    DatasetLayout layout() const{
+        return DatasetLayout(header().layout);
+    }
+
+    ///@return The payload of a RowMajor Float32 file
+    Map<const MatrixXfR> entities() const;
+    ///@return The payload of a ColumnMajor Float32 file
+    Map<const MatrixXf> columnMajorEntities() const;
+    ///@return The payload of an Int32 file with a single column
+    Map<const VectorXi> labels() const;
+
+    /*!
+     * @brief       A source for streamingKmeansGenerator() and streamingCalculateLabels() reading the datapoints of a RowMajor Float32 file.
+     *              Each chunk is a single contiguous copy out of the mapping, so only the chunk and the pages being read are resident
+    */
+    struct ChunkSource{
+        const MappedDataset     *dataset;
+        Index                   position;
+
+        int operator()(Ref<MatrixXfR> chunk);
+    };
+
+    ///@return A source reading the datapoints from the first one, the file must be RowMajor Float32
+    ChunkSource chunkSource() const;
+
+private:
+    const void      *mapping = nullptr;
+    std::size_t     mappingSize = 0;
+
+    const void *payload() const{
+        return static_cast<const char*>(mapping) + sizeof(DatasetHeader);
+    }
+};
+
+/*!
+ * @brief       Writes a matrix of floats, for example centroids or datapoints, as a dataset file
+ * @param[in]   path        The path of the file, overwritten if it exists
+ * @param[in]   matrix      The values to write
+ * @param[in]   layout      The order the values are written in
+ * @return      false if the file can't be written
+*/
+bool writeDataset(
+        const std::string           &path,
+        const Ref<const MatrixXfR>  &matrix,
+        DatasetLayout               layout = DatasetLayout::RowMajor
+    );
+
+/*!
+ * @brief       Writes labels as an Int32 dataset file with a single column
+ * @param[in]   path        The path of the file, overwritten if it exists
+ * @param[in]   labels      The labels to write
+ * @return      false if the file can't be written
+*/
+bool writeDataset(
+        const std::string           &path,
+        const Ref<const VectorXi>   &labels
+    );
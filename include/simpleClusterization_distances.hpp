@@ -0,0 +1,411 @@
+#pragma once
+///@file simpleClusterization_distances.hpp
+///@brief Batched distance engines, used automatically by the library whenever the metric is SquaredEuclideanMetric or ManhattanMetric
+///@details The squared euclidean distances between a tile of datapoints X and the centroids C are computed as norm(x)^2 + norm(c)^2 - 2 * X * C^T,
+///         so that the bulk of the work is a single matrix product. Datapoints are processed a tile at a time, and each tile is
+///         consumed (argmin, fuzzy inverse...) while it's still in cache, so the full k x n distance matrix is never built unless explicitly requested.
+///         When the CPU has AVX2 or AVX-512, the SIMD kernels of simpleClusterization_simd.hpp compare each datapoint to a panel of centroids instead,
+///         which is faster as long as the panel stays in the L1 cache, and is the only batched path of the manhattan metric.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <type_traits>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_simd.hpp>
+
+using namespace Eigen;
+
+///The approximate amount of memory that a tile of datapoints and its distances should take, sized to stay within a typical L2 cache
+const int distanceTileBytes = 1 << 18;
+///Squared euclidean distances of the matrix product formula below this fraction of the squared norm of their datapoint are computed again directly where
+///their precision matters, see refineSquaredEuclideanDistances()
+const float cancellationRatio = 1.0E-3f;
+///The largest centroids panel the SIMD kernels use for the squared euclidean metric, sized to stay within a typical L1 cache. Larger ones go through the matrix product
+const int simdPanelMaxBytes = 1 << 15;
+
+/*!
+ * @brief       Returns how many datapoints the distance engine processes at a time
+ * @param[in]   statsNumber     The dimensionality of the datapoints
+ * @param[in]   clustersNumber  The number of centroids
+ * @return      The number of rows of a tile
+*/
+inline int distanceTileRows(
+        int statsNumber,
+        int clustersNumber
+    ){
+    return std::max(64, distanceTileBytes / int(sizeof(float) * (statsNumber + clustersNumber)));
+}
+
+///Scratch buffers of blockedSquaredEuclideanDistances(), kept by the callers that run it repeatedly so that it doesn't allocate at every call.
+///They're only grown, see storageView()
+struct DistanceWorkspace{
+    ///The distances of the current tile of datapoints
+    VectorXf    tile;
+    ///The squared norms of the centroids
+    VectorXf    centroidsSquaredNorms;
+    ///The centroids laid out for the SIMD kernels, see centroidsPanel()
+    VectorXf    centroidsPanel;
+    ///The index of the closest centroid to each datapoint of the current tile
+    VectorXi    tileLabels;
+
+    ///Grows the buffers to the sizes a call on entitiesNumber datapoints of statsNumber dimensions and up to centroidsNumber centroids needs
+    void reserve(
+            int entitiesNumber,
+            int statsNumber,
+            int centroidsNumber
+        ){
+        const int tileRows = std::min(distanceTileRows(statsNumber, centroidsNumber), entitiesNumber);
+        storageView<VectorXf>(tile, tileRows * simdPanelColumns(centroidsNumber), 1);
+        storageView<VectorXf>(centroidsSquaredNorms, centroidsNumber, 1);
+        storageView<VectorXf>(centroidsPanel, statsNumber * simdPanelColumns(centroidsNumber), 1);
+        storageView<VectorXi>(tileLabels, tileRows, 1);
+    }
+};
+
+/*!
+ * @brief       Computes the squared euclidean distances between the datapoints and the centroids one tile of datapoints at a time
+ * @note        Cancellation can make the product formula slightly negative for coincident points, so distances are clamped to 0
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, as they don't change between calls they're meant to be cached by the caller
+ * @param[in]   centroids               The centroids of the clusters, any expression so that datapoints can serve as centroids without a copy
+ * @param[in]   workspace               The buffers the tiles are computed in
+ * @param[in]   tileFunction            Called for every tile as tileFunction(firstEntity, tileDistances), where tileDistances(j, i) is the distance between
+ *                                      the (firstEntity + j)-th datapoint and the i-th centroid
+*/
+template<typename Derived, typename DerivedCentroids, typename TileFunction>
+void blockedSquaredEuclideanDistances(
+        const MatrixBase<Derived>           &entities,
+        const Ref<const VectorXf>           &entitiesSquaredNorms,
+        const MatrixBase<DerivedCentroids>  &centroids,
+        DistanceWorkspace                   &workspace,
+        TileFunction                        &&tileFunction
+    ){
+    auto centroidsSquaredNorms = storageView<RowVectorXf>(workspace.centroidsSquaredNorms, 1, centroids.rows());
+    centroidsSquaredNorms = centroids.rowwise().squaredNorm().transpose();
+    blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, centroidsSquaredNorms, workspace, tileFunction);
+}
+
+/*!
+ * @brief       Same as blockedSquaredEuclideanDistances() above, with the squared norms of the centroids computed beforehand, for centroids that serve many calls
+ * @param[in]   centroidsSquaredNorms   The squared norms of the rows of centroids
+*/
+template<typename Derived, typename DerivedCentroids, typename TileFunction>
+void blockedSquaredEuclideanDistances(
+        const MatrixBase<Derived>           &entities,
+        const Ref<const VectorXf>           &entitiesSquaredNorms,
+        const MatrixBase<DerivedCentroids>  &centroids,
+        const Ref<const RowVectorXf>        &centroidsSquaredNorms,
+        DistanceWorkspace                   &workspace,
+        TileFunction                        &&tileFunction
+    ){
+    assert(entities.cols()==centroids.cols() && entities.rows()==entitiesSquaredNorms.size() && centroids.rows()==centroidsSquaredNorms.size()
+           && "blockedSquaredEuclideanDistances: incompatible matrix sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    const int tileRows = std::min(distanceTileRows(entities.cols(), clustersNumber), entitiesNumber);
+    auto tile = storageView<MatrixXfR>(workspace.tile, tileRows, clustersNumber);
+    for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+        const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+        auto tileDistances = tile.topRows(currentRows);
+        tileDistances.noalias() = entities.middleRows(firstEntity, currentRows) * centroids.transpose();
+        tileDistances = ((-2.f * tileDistances).rowwise() + centroidsSquaredNorms).colwise() + entitiesSquaredNorms.segment(firstEntity, currentRows);
+        tileDistances = tileDistances.cwiseMax(0.f);
+        tileFunction(firstEntity, tileDistances);
+    }
+}
+
+/*!
+ * @brief       Same as blockedSquaredEuclideanDistances() above, with buffers allocated for the call
+*/
+template<typename Derived, typename DerivedCentroids, typename TileFunction>
+void blockedSquaredEuclideanDistances(
+        const MatrixBase<Derived>           &entities,
+        const Ref<const VectorXf>           &entitiesSquaredNorms,
+        const MatrixBase<DerivedCentroids>  &centroids,
+        TileFunction                        &&tileFunction
+    ){
+    DistanceWorkspace workspace;
+    blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, workspace, tileFunction);
+}
+
+/*!
+ * @brief       Computes again directly the squared euclidean distances of a datapoint that the matrix product formula of blockedSquaredEuclideanDistances()
+ *              lost to cancellation
+ * @details     ||x||^2 + ||c||^2 - 2 x.c keeps the precision of the squared norms, not of the distance, so the distance between a datapoint and a close centroid
+ *              can come out as rounding noise or 0. That matters wherever the distances are inverted or divided by each other, so there the distances below
+ *              cancellationRatio times the squared norm of the datapoint are replaced by the value of SquaredEuclideanMetric
+ * @param[in]   entity              The datapoint
+ * @param[in]   entitySquaredNorm   The squared norm of the datapoint
+ * @param[in]   centroids           The centroids of the clusters
+ * @param[in]   indices             The index of the centroid of each distance, or nullptr if the i-th distance is the one to the i-th centroid
+ * @param[in-out] distances         The distances between the datapoint and the centroids, any writable vector expression
+*/
+template<typename DerivedEntity, typename DerivedCentroids, typename DerivedDistances>
+void refineSquaredEuclideanDistances(
+        const MatrixBase<DerivedEntity>     &entity,
+        float                               entitySquaredNorm,
+        const MatrixBase<DerivedCentroids>  &centroids,
+        const int                           *indices,
+        const MatrixBase<DerivedDistances>  &distances
+    ){
+    auto &refinedDistances = distances.const_cast_derived();
+    const float threshold = cancellationRatio * entitySquaredNorm;
+    for(Index i=0;i<refinedDistances.size();++i){
+        if(refinedDistances(i) < threshold){
+            refinedDistances(i) = (centroids.row(indices ? indices[i] : i) - entity).squaredNorm();
+        }
+    }
+}
+
+/*!
+ * @brief       Returns whether the SIMD kernels should compute the values of a metric, rather than the matrix product or the generic loops
+ * @details     Only the AVX2 and AVX-512 kernels are used, the portable ones are slower than the paths they'd replace.
+ *              The squared euclidean metric also needs the panel to fit within simdPanelMaxBytes
+ * @param[in]   statsNumber     The dimensionality of the datapoints
+ * @param[in]   clustersNumber  The number of centroids
+ * @return      true if the SIMD kernels should be used
+*/
+template<typename Metric>
+bool useSimdPanel(
+        int statsNumber,
+        int clustersNumber
+    ){
+    if(simdKernels().level==SimdLevel::Portable){
+        return false;
+    }
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        return Index(sizeof(float)) * statsNumber * simdPanelColumns(clustersNumber) <= simdPanelMaxBytes;
+    }
+    return std::is_same_v<Metric, ManhattanMetric>;
+}
+
+///Returns the panelDistances_t kernel of a metric for which useSimdPanel() holds
+template<typename Metric>
+panelDistances_t *simdPanelDistances(){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        return simdKernels().squaredEuclideanPanelDistances;
+    }
+    return simdKernels().manhattanPanelDistances;
+}
+
+///Returns the panelArgmin_t kernel of a metric for which useSimdPanel() holds
+template<typename Metric>
+panelArgmin_t *simdPanelArgmin(){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        return simdKernels().squaredEuclideanPanelArgmin;
+    }
+    return simdKernels().manhattanPanelArgmin;
+}
+
+/*!
+ * @brief       Computes the values of a metric between the datapoints and the centroids one tile of datapoints at a time, through the SIMD kernels
+ * @param[in]   entities        The datapoints
+ * @param[in]   centroids       The centroids of the clusters, any expression so that datapoints can serve as centroids without a copy
+ * @param[in]   kernel          The kernel of the metric, see simdPanelDistances()
+ * @param[in]   workspace       The buffers the panel and the tiles are computed in
+ * @param[in]   tileFunction    Called for every tile as tileFunction(firstEntity, tileDistances), like in blockedSquaredEuclideanDistances()
+*/
+template<typename DerivedCentroids, typename TileFunction>
+void blockedPanelDistances(
+        const Ref<const MatrixXfR>          &entities,
+        const MatrixBase<DerivedCentroids>  &centroids,
+        panelDistances_t                    *kernel,
+        DistanceWorkspace                   &workspace,
+        TileFunction                        &&tileFunction
+    ){
+    assert(entities.cols()==centroids.cols() && "blockedPanelDistances: incompatible matrix sizes\n");
+    blockedPanelDistances(entities, centroidsPanel(centroids, workspace.centroidsPanel), centroids.rows(), kernel, workspace, tileFunction);
+}
+
+/*!
+ * @brief       Same as blockedPanelDistances() above, on a panel laid out beforehand by centroidsPanel(), for centroids that serve many calls
+ * @param[in]   panel           The panel of the centroids
+ * @param[in]   clustersNumber  The number of centroids in the panel, its padding excluded
+*/
+template<typename TileFunction>
+void blockedPanelDistances(
+        const Ref<const MatrixXfR>          &entities,
+        const Ref<const MatrixXfR>          &panel,
+        int                                 clustersNumber,
+        panelDistances_t                    *kernel,
+        DistanceWorkspace                   &workspace,
+        TileFunction                        &&tileFunction
+    ){
+    assert(entities.cols()==panel.rows() && clustersNumber<=panel.cols() && "blockedPanelDistances: incompatible matrix sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int tileRows = std::min(distanceTileRows(entities.cols(), clustersNumber), entitiesNumber);
+    auto tile = storageView<MatrixXfR>(workspace.tile, tileRows, panel.cols());
+    for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+        const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+        kernel(entities.row(firstEntity).data(), currentRows, entities.outerStride(), panel.data(), panel.rows(), panel.cols(), tile.data(), tile.cols());
+        tileFunction(firstEntity, tile.topLeftCorner(currentRows, clustersNumber));
+    }
+}
+
+/*!
+ * @brief       Computes the values of any metric between the datapoints and the centroids one tile of datapoints at a time,
+ *              through the matrix product for the squared euclidean metric, the SIMD kernels when useSimdPanel() holds, and plain loops otherwise
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read for the squared euclidean metric
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in]   metric                  The metric functor
+ * @param[in]   workspace               The buffers the tiles are computed in
+ * @param[in]   tileFunction            Called for every tile as tileFunction(firstEntity, tileDistances), like in blockedSquaredEuclideanDistances(),
+ *                                      the rows of tileDistances being contiguous
+*/
+template<typename Metric, typename TileFunction>
+void blockedMetricDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        DistanceWorkspace           &workspace,
+        TileFunction                &&tileFunction
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, workspace, tileFunction);
+        return;
+    }
+    if(useSimdPanel<Metric>(entities.cols(), centroids.rows())){
+        blockedPanelDistances(entities, centroids, simdPanelDistances<Metric>(), workspace, tileFunction);
+        return;
+    }
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    const int tileRows = std::min(distanceTileRows(entities.cols(), clustersNumber), entitiesNumber);
+    auto tile = storageView<MatrixXfR>(workspace.tile, tileRows, clustersNumber);
+    for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+        const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+        auto tileDistances = tile.topRows(currentRows);
+        for(int j=0;j<currentRows;++j){
+            for(int i=0;i<clustersNumber;++i){
+                tileDistances(j, i) = metric(centroids.row(i), entities.row(firstEntity + j));
+            }
+        }
+        tileFunction(firstEntity, tileDistances);
+    }
+}
+
+/*!
+ * @brief       Builds the full matrix of squared euclidean distances between centroids and datapoints
+ * @warning     This materializes a k x n matrix, prefer blockedSquaredEuclideanDistances() whenever the distances can be consumed tile by tile
+ * @param[in]   entities    The datapoints
+ * @param[in]   centroids   The centroids of the clusters
+ * @param[out]  distances   distances(i, j) is the squared distance between the i-th centroid and the j-th datapoint
+*/
+void squaredEuclideanDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              distances
+    );
+
+/*!
+ * @brief       Same as calculateLabels() with SquaredEuclideanMetric, with the argmin fused into the tiles of the distance engine,
+ *              or computed by the SIMD kernels for panels that fit in the L1 cache
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in]   workspace               The buffers of the distance engine
+ * @param[in-out] labels                The index of the closest centroid to each datapoint
+ * @param[out]  nearestDistances        If not null, filled with the squared distance between each datapoint and its closest centroid
+ * @return      The number of labels that changed
+*/
+int squaredEuclideanLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    );
+
+/*!
+ * @brief       Same as calculateFuzzyWeights() with SquaredEuclideanMetric, with the inversion fused into the tiles of the distance engine.
+ *              The distances the matrix product formula lost to cancellation are computed again first, see refineSquaredEuclideanDistances()
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in]   workspace               The buffers of the distance engine
+ * @param[out]  weights                 The resulting, not normalized, weights
+*/
+void squaredEuclideanFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<MatrixXfR>              weights
+    );
+
+/*!
+ * @brief       Same as squaredEuclideanFuzzyWeights() above, with the squared norms of the centroids computed beforehand, for centroids that serve many calls
+ * @param[in]   centroidsSquaredNorms   The squared norms of the rows of centroids
+*/
+void squaredEuclideanFuzzyWeights(
+        const Ref<const MatrixXfR>      &entities,
+        const Ref<const VectorXf>       &entitiesSquaredNorms,
+        const Ref<const MatrixXf>       &centroids,
+        const Ref<const RowVectorXf>    &centroidsSquaredNorms,
+        DistanceWorkspace               &workspace,
+        Ref<MatrixXfR>                  weights
+    );
+
+/*!
+ * @brief       Same as calculateLabels() with a metric for which useSimdPanel() holds, the argmin being computed by the SIMD kernels
+ * @param[in]   entities        The datapoints
+ * @param[in]   centroids       The centroids of the clusters
+ * @param[in]   kernel          The kernel of the metric, see simdPanelArgmin()
+ * @param[in]   workspace       The buffers the panel and the labels of a tile are computed in
+ * @param[in-out] labels        The index of the closest centroid to each datapoint
+ * @param[out]  nearestDistances    If not null, filled with the value of the metric between each datapoint and its closest centroid
+ * @return      The number of labels that changed
+*/
+int panelLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        panelArgmin_t               *kernel,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    );
+
+/*!
+ * @brief       Same as panelLabels(), on a panel laid out beforehand by centroidsPanel(), for centroids that serve many calls
+ * @param[in]   panel       The panel of the centroids
+*/
+int preparedPanelLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXfR>  &panel,
+        panelArgmin_t               *kernel,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    );
+
+/*!
+ * @brief       Same as squaredEuclideanLabels(), always through the matrix product, with the squared norms of the centroids computed beforehand
+ * @param[in]   centroidsSquaredNorms   The squared norms of the rows of centroids
+*/
+int preparedSquaredEuclideanLabels(
+        const Ref<const MatrixXfR>      &entities,
+        const Ref<const VectorXf>       &entitiesSquaredNorms,
+        const Ref<const MatrixXf>       &centroids,
+        const Ref<const RowVectorXf>    &centroidsSquaredNorms,
+        DistanceWorkspace               &workspace,
+        Ref<VectorXi>                   labels,
+        Ref<VectorXf>                   *nearestDistances
+    );
+
+/*!
+ * @brief       Same as calculateFuzzyWeights() with ManhattanMetric, the distances being computed by the SIMD kernels
+ * @param[in]   entities    The datapoints
+ * @param[in]   centroids   The centroids of the clusters
+ * @param[in]   workspace   The buffers of the distance engine
+ * @param[out]  weights     The resulting, not normalized, weights
+*/
+void manhattanFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<MatrixXfR>              weights
+    );
@@ -0,0 +1,182 @@
+#pragma once
+///@file simpleClusterization_fcm.hpp
+///@brief Building blocks of FCMGenerator(): fuzzy c-means iterations that run on a reusable workspace
+///@details A single pass over the datapoints, one tile at a time, computes the new memberships from the distances to the centroids,
+///         accumulates the squared change of the memberships (the convergence residual) and accumulates the sums the next centroids are made of,
+///         so the k x n memberships are only read and written once per iteration and never copied.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_stats.hpp>
+
+using namespace Eigen;
+
+///Scratch buffers of FCMGenerator(). They're only grown (see storageView()), so repeated runs don't allocate once the largest sizes have been seen
+struct FcmWorkspace{
+    ///The squared norms of the datapoints, for the squared euclidean metric
+    VectorXf            entitiesSquaredNorms;
+    ///The buffers of the distance engine, its tile also holds the distances of the other metrics
+    DistanceWorkspace   distances;
+    ///The memberships of a tile of datapoints, then the same raised to the fuzziness
+    VectorXf            membershipsTile;
+    ///The sums of the datapoints weighted by their powered memberships, one row per centroid
+    VectorXf            centroidsNumerators;
+    ///The sums of the powered memberships of each centroid
+    VectorXf            centroidsDenominators;
+    ///The closest centroids of a datapoint and their memberships, for the sparse memberships of simpleClusterization_sparse.hpp
+    VectorXi            selectedIndices;
+    VectorXf            selectedWeights;
+    ///The statistics the runs report to, nullptr if none are attached (see ClusteringContext::setStats())
+    ClusteringStats     *stats              = nullptr;
+};
+
+/*!
+ * @brief       Raises the memberships of a tile to the fuzziness and adds their contribution to the sums the centroids are made of
+ * @param[in]   entities                The datapoints of the tile
+ * @param[in]   fuzziness               The fuzziness exponent m
+ * @param[in-out] memberships           The memberships of the tile, one row per datapoint, raised to the fuzziness on return
+ * @param[in-out] centroidsNumerators   The sums of the datapoints weighted by their powered memberships
+ * @param[in-out] centroidsDenominators The sums of the powered memberships
+*/
+template<typename DerivedEntities, typename DerivedMemberships>
+void accumulateFcmCentroids(
+        const MatrixBase<DerivedEntities>   &entities,
+        float                               fuzziness,
+        MatrixBase<DerivedMemberships>      &memberships,
+        Ref<MatrixXf>                       centroidsNumerators,
+        Ref<VectorXf>                       centroidsDenominators
+    ){
+    if(fuzziness==2.f){
+        memberships = memberships.cwiseAbs2();
+    }else{
+        memberships = memberships.array().pow(fuzziness).matrix();
+    }
+    centroidsNumerators.noalias() += memberships.transpose() * entities;
+    centroidsDenominators += memberships.colwise().sum().transpose();
+}
+
+/*!
+ * @brief       Accumulates the sums the centroids are made of from given memberships
+ * @param[in]   entities        The datapoints
+ * @param[in]   weights         The memberships, one row per centroid
+ * @param[in]   fuzziness       The fuzziness exponent m
+ * @param[in-out] workspace     The workspace, its sums are reset first
+*/
+inline void fcmCentroidsSums(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXfR>  &weights,
+        float                       fuzziness,
+        FcmWorkspace                &workspace
+    ){
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = weights.rows();
+    const int tileRows = std::min(distanceTileRows(entities.cols(), clustersNumber), entitiesNumber);
+    auto centroidsNumerators = storageView<MatrixXf>(workspace.centroidsNumerators, clustersNumber, entities.cols());
+    auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, clustersNumber, 1);
+    auto membershipsTile = storageView<MatrixXfR>(workspace.membershipsTile, tileRows, clustersNumber);
+    centroidsNumerators.setZero();
+    centroidsDenominators.setZero();
+    for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+        const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+        auto memberships = membershipsTile.topRows(currentRows);
+        memberships = weights.middleCols(firstEntity, currentRows).transpose();
+        accumulateFcmCentroids(entities.middleRows(firstEntity, currentRows), fuzziness, memberships, centroidsNumerators, centroidsDenominators);
+    }
+}
+
+/*!
+ * @brief       Sets the centroids to the sums accumulated in the workspace, c_i = (sum_j w_ij^m * x_j) / (sum_j w_ij^m)
+ * @param[out]  centroids   The centroids of the clusters
+ * @param[in]   workspace   The workspace holding the sums
+*/
+inline void fcmCentroidsFromSums(
+        Ref<MatrixXf>               centroids,
+        FcmWorkspace                &workspace
+    ){
+    const auto centroidsNumerators = storageView<MatrixXf>(workspace.centroidsNumerators, centroids.rows(), centroids.cols());
+    const auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, centroids.rows(), 1);
+    centroids = centroidsNumerators.array().colwise() / centroidsDenominators.array();
+}
+
+/*!
+ * @brief       Updates the memberships from the centroids, w_ij = 1 / (sum_k (d(x_j, c_i) / d(x_j, c_k)) ^ (1 / (m - 1))), where d is the value of the metric.
+ *              The sums the next centroids are made of are accumulated at the same time
+ * @details     The ratios are taken with respect to the closest centroid, so that they can't overflow for fuzziness close to 1.
+ *              A datapoint that coincides with some centroids is shared evenly between them
+ * @param[in]   entities        The datapoints
+ * @param[in]   centroids       The centroids of the clusters
+ * @param[in]   metric          The metric functor you want to use
+ * @param[in]   fuzziness       The fuzziness exponent m, greater than 1
+ * @param[in-out] weights       The memberships, one row per centroid
+ * @param[in-out] workspace     The workspace, its entitiesSquaredNorms must be up to date for the squared euclidean metric and its sums are reset first
+ * @return      The squared norm of the change of the memberships
+*/
+template<typename Metric>
+float updateFcmMemberships(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        float                       fuzziness,
+        Ref<MatrixXfR>              weights,
+        FcmWorkspace                &workspace
+    ){
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    const float ratioExponent = 1.f / (fuzziness - 1.f);
+    const float coincidenceThreshold = FCM_THRESHOLD;
+    double residual = 0;
+    const int tileRows = std::min(distanceTileRows(entities.cols(), clustersNumber), entitiesNumber);
+    auto centroidsNumerators = storageView<MatrixXf>(workspace.centroidsNumerators, clustersNumber, entities.cols());
+    auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, clustersNumber, 1);
+    auto membershipsTile = storageView<MatrixXfR>(workspace.membershipsTile, tileRows, clustersNumber);
+    centroidsNumerators.setZero();
+    centroidsDenominators.setZero();
+    const auto entitiesSquaredNorms = storageView<VectorXf>(workspace.entitiesSquaredNorms, MetricTraits<Metric>::isSquaredEuclidean ? entitiesNumber : 0, 1);
+    auto processTile = [&](int firstEntity, const auto &tileDistances){
+        const int currentRows = tileDistances.rows();
+        auto memberships = membershipsTile.topRows(currentRows);
+        //The distances are turned into memberships in place, once those the matrix product formula lost to cancellation are computed again
+        memberships = tileDistances;
+        for(int j=0;j<currentRows;++j){
+            auto distances = memberships.row(j);
+            if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+                refineSquaredEuclideanDistances(entities.row(firstEntity + j), entitiesSquaredNorms(firstEntity + j), centroids, nullptr, distances);
+            }
+            const float minDistance = distances.minCoeff();
+            if(minDistance <= coincidenceThreshold){
+                distances = (distances.array() <= coincidenceThreshold).template cast<float>().matrix();
+            }else if(fuzziness==2.f){
+                distances = minDistance * distances.cwiseInverse();
+            }else{
+                distances = (minDistance * distances.array().inverse()).pow(ratioExponent).matrix();
+            }
+            distances /= distances.sum();
+        }
+        auto weightsBlock = weights.middleCols(firstEntity, currentRows);
+        residual += (weightsBlock - memberships.transpose()).squaredNorm();
+        weightsBlock = memberships.transpose();
+        accumulateFcmCentroids(entities.middleRows(firstEntity, currentRows), fuzziness, memberships, centroidsNumerators, centroidsDenominators);
+    };
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, workspace.distances, processTile);
+    }else if(useSimdPanel<Metric>(entities.cols(), clustersNumber)){
+        blockedPanelDistances(entities, centroids, simdPanelDistances<Metric>(), workspace.distances, processTile);
+    }else{
+        auto tile = storageView<MatrixXfR>(workspace.distances.tile, tileRows, clustersNumber);
+        for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+            const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+            auto tileDistances = tile.topRows(currentRows);
+            for(int j=0;j<currentRows;++j){
+                for(int i=0;i<clustersNumber;++i){
+                    tileDistances(j, i) = metric(centroids.row(i), entities.row(firstEntity + j));
+                }
+            }
+            processTile(firstEntity, tileDistances);
+        }
+    }
+    return float(residual);
+}
@@ -0,0 +1,1714 @@
+#pragma once
+///@file simpleClusterization_impl.hpp
+///@brief Definitions of the templated functions declared in simpleClusterization.hpp, it's not meant to be included directly
+///@details The overloads without a ClusteringContext create a temporary one and forward to the overloads that take it.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <memory>
+#include <random>
+#include <vector>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_threadPool.hpp>
+#include <simpleClusterization_kmeans.hpp>
+#include <simpleClusterization_initializers.hpp>
+#include <simpleClusterization_silhouette.hpp>
+#include <simpleClusterization_streaming.hpp>
+#include <simpleClusterization_context.hpp>
+
+using namespace Eigen;
+
+/*!
+ * @brief       Computes the squared norms of the datapoints into the context, if the metric needs them
+ * @param[in]   entities    The datapoints
+ * @param[in]   context     The context holding the norms
+ * @return      A view over the norms, empty for the metrics that don't use them
+*/
+template<typename Metric>
+Map<VectorXf> contextSquaredNorms(
+        const Ref<const MatrixXfR>  &entities,
+        ClusteringContext           &context
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        auto entitiesSquaredNorms = storageView<VectorXf>(context.entitiesSquaredNorms, entities.rows(), 1);
+        entitiesSquaredNorms = entities.rowwise().squaredNorm();
+        return entitiesSquaredNorms;
+    }
+    return storageView<VectorXf>(context.entitiesSquaredNorms, 0, 1);
+}
+
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric
+        ){
+    ClusteringContext context;
+    calculateFuzzyWeights(entities, centroids, weights, metric, context);
+}
+
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        ){
+    PhaseTimer assignmentTimer(context.stats(), ClusteringPhase::Assignment);
+    if(context.stats()){
+        context.stats()->addDistanceEvaluations((long long)entities.rows() * centroids.rows());
+    }
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        squaredEuclideanFuzzyWeights(entities, contextSquaredNorms<Metric>(entities, context), centroids, context.sweepWorkspaces[0].kmeans.distances, weights);
+        return;
+    }
+    if(useSimdPanel<Metric>(entities.cols(), centroids.rows())){
+        manhattanFuzzyWeights(entities, centroids, context.sweepWorkspaces[0].kmeans.distances, weights);
+        return;
+    }
+    const int entitiesNumber  = entities.rows();
+    const int centroidsNumber = centroids.rows();
+    for(int i=0;i<centroidsNumber;++i){
+        for(int j=0;j<entitiesNumber;++j){
+            weights(i, j) = metric(centroids.row(i), entities.row(j));
+            assert(weights(i, j)> FCM_THRESHOLD && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+        }
+    }
+    weights.array() = 1.0 / weights.array();
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric
+    ){
+    FCMGenerator(entities, centroids, weights, metric, FcmOptions());
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options
+    ){
+    FcmWorkspace workspace;
+    FCMGenerator(entities, centroids, weights, metric, options, workspace);
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    ){
+    FCMGenerator(entities, centroids, weights, metric, options, context.fcm);
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        FcmWorkspace                &workspace
+    ){
+    //The loop is as following:
+    //1 - We initialize weights to random values from 0 to 1, normalized so that the weights of each datapoint sum up to 1, or from the centroids if they're provided
+    //2 - We calculate the Centroids of each cluster (what is gonna end up in entities as a Statistical Entity according to the following formula: c_j = (Sum_i w_ij^m * x_i)/(Sum_i w_ij^m)
+    //3 - We update weights according to this formula:  w_ij = 1 / (Sum_k (distance(x_i, c_j)/distance(x_i, c_k)) ^ (2 / m-1)) where m is the fuzziness parameter
+    // Loop until Norm(W_i+1 - W_i) < Epsilon where Epsilon is options.tolerance
+    //Steps 2 and 3 are fused into a single pass over the datapoints, see simpleClusterization_fcm.hpp
+    assert(weights.cols()==entities.rows() && centroids.rows()==weights.rows() && centroids.cols()==entities.cols() && "Matrix sizes for FCMGenerator not compatibles\n");
+    assert(options.fuzziness > 1 && "FCMGenerator: the fuzziness must be greater than 1\n");
+    ClusteringStats *stats = workspace.stats;
+    const long long iterationDistanceEvaluations = (long long)entities.rows() * centroids.rows();
+    PhaseTimer initializationTimer(stats, ClusteringPhase::Initialization);
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        storageView<VectorXf>(workspace.entitiesSquaredNorms, entities.rows(), 1) = entities.rowwise().squaredNorm();
+    }
+    if(options.initializeFromCentroids){
+        updateFcmMemberships(entities, centroids, metric, options.fuzziness, weights, workspace);
+        if(stats){
+            stats->addDistanceEvaluations(iterationDistanceEvaluations);
+        }
+    }else{
+        FixedSeedSequence<2> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32)}};
+        std::mt19937_64 generator(seeds);
+        std::uniform_real_distribution<float> weightDistribution(0, 1);
+        for(Index i=0;i<weights.rows();++i){
+            for(Index j=0;j<weights.cols();++j){
+                weights(i, j) = weightDistribution(generator);
+            }
+        }
+        weights.array().rowwise() /= weights.colwise().sum().array();
+        fcmCentroidsSums(entities, weights, options.fuzziness, workspace);
+    }
+    initializationTimer.stop();
+    bool converged = false;
+    for(int loopIndex=0;loopIndex<options.maxIterations;++loopIndex){
+        PhaseTimer updateTimer(stats, ClusteringPhase::Update);
+        fcmCentroidsFromSums(centroids, workspace);
+        updateTimer.stop();
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        const float residual = updateFcmMemberships(entities, centroids, metric, options.fuzziness, weights, workspace);
+        assignmentTimer.stop();
+        if(stats){
+            stats->recordIteration({ClusteringAlgorithm::FuzzyCMeans, int(centroids.rows()), loopIndex, -1, residual}, iterationDistanceEvaluations);
+        }
+        if(residual <= options.tolerance){
+            converged = true;
+            break;
+        }
+    }
+    if(stats){
+        stats->recordRun(converged);
+    }
+}
+
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric
+        ){
+    ClusteringContext context;
+    calculateFuzzyWeights(entities, centroids, weights, metric, context);
+}
+
+template<typename Metric>
+void calculateFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+        ){
+    assert(weights.entitiesNumber()==entities.rows() && weights.membershipsNumber() > 0 && "calculateFuzzyWeights: incompatible matrix sizes\n");
+    const int clustersNumber = centroids.rows();
+    const int membershipsNumber = weights.membershipsNumber();
+    PhaseTimer assignmentTimer(context.stats(), ClusteringPhase::Assignment);
+    if(context.stats()){
+        context.stats()->addDistanceEvaluations((long long)entities.rows() * clustersNumber);
+    }
+    const auto entitiesSquaredNorms = contextSquaredNorms<Metric>(entities, context);
+    //The distances of the closest centroids are selected straight into the memberships, then turned into normalized inverses
+    auto selectTile = [&](int firstEntity, const auto &tileDistances){
+        for(int t=0;t<tileDistances.rows();++t){
+            const int j = firstEntity + t;
+            const int keptNumber = selectSmallestDistances(&tileDistances(t, 0), clustersNumber, membershipsNumber, &weights.indices(j, 0), &weights.weights(j, 0));
+            refineSelectedDistances<Metric>(entities.row(j), MetricTraits<Metric>::isSquaredEuclidean ? entitiesSquaredNorms(j) : 0.f, centroids, keptNumber,
+                                            &weights.indices(j, 0), &weights.weights(j, 0));
+            auto kept = weights.weights.row(j).head(keptNumber);
+            assert(kept(0) > FCM_THRESHOLD && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+            kept = kept.cwiseInverse();
+            kept /= kept.sum();
+            weights.indices.row(j).tail(membershipsNumber - keptNumber).setConstant(-1);
+            weights.weights.row(j).tail(membershipsNumber - keptNumber).setZero();
+        }
+    };
+    blockedMetricDistances(entities, entitiesSquaredNorms, centroids, metric, context.sweepWorkspaces[0].kmeans.distances, selectTile);
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options
+    ){
+    FcmWorkspace workspace;
+    FCMGenerator(entities, centroids, weights, metric, options, workspace);
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    ){
+    FCMGenerator(entities, centroids, weights, metric, options, context.fcm);
+}
+
+template<typename Metric>
+void FCMGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        FcmWorkspace                &workspace
+    ){
+    //The same loop as the dense FCMGenerator(), on the memberships of the closest centroids only, see simpleClusterization_sparse.hpp
+    assert(weights.entitiesNumber()==entities.rows() && weights.membershipsNumber() > 0 && centroids.cols()==entities.cols() && "Matrix sizes for FCMGenerator not compatibles\n");
+    assert(options.fuzziness > 1 && "FCMGenerator: the fuzziness must be greater than 1\n");
+    const int clustersNumber = centroids.rows();
+    const int membershipsNumber = weights.membershipsNumber();
+    ClusteringStats *stats = workspace.stats;
+    const long long iterationDistanceEvaluations = (long long)entities.rows() * clustersNumber;
+    PhaseTimer initializationTimer(stats, ClusteringPhase::Initialization);
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        storageView<VectorXf>(workspace.entitiesSquaredNorms, entities.rows(), 1) = entities.rowwise().squaredNorm();
+    }
+    if(options.initializeFromCentroids){
+        updateSparseFcmMemberships(entities, centroids, metric, options.fuzziness, weights, workspace);
+        if(stats){
+            stats->addDistanceEvaluations(iterationDistanceEvaluations);
+        }
+    }else{
+        //Random memberships over consecutive clusters from a random one, so that every cluster gets datapoints
+        const int keptNumber = std::min(membershipsNumber, clustersNumber);
+        FixedSeedSequence<2> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32)}};
+        std::mt19937_64 generator(seeds);
+        std::uniform_real_distribution<float> weightDistribution(0, 1);
+        std::uniform_int_distribution<int> clusterDistribution(0, clustersNumber - 1);
+        for(Index j=0;j<entities.rows();++j){
+            const int firstCluster = clusterDistribution(generator);
+            for(int r=0;r<membershipsNumber;++r){
+                weights.indices(j, r) = r < keptNumber ? (firstCluster + r) % clustersNumber : -1;
+                weights.weights(j, r) = r < keptNumber ? weightDistribution(generator) : 0.f;
+            }
+        }
+        weights.weights.array().colwise() /= weights.weights.rowwise().sum().array();
+        sparseFcmCentroidsSums(entities, weights, clustersNumber, options.fuzziness, workspace);
+    }
+    initializationTimer.stop();
+    bool converged = false;
+    for(int loopIndex=0;loopIndex<options.maxIterations;++loopIndex){
+        PhaseTimer updateTimer(stats, ClusteringPhase::Update);
+        sparseFcmCentroidsFromSums(centroids, workspace);
+        updateTimer.stop();
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        const float residual = updateSparseFcmMemberships(entities, centroids, metric, options.fuzziness, weights, workspace);
+        assignmentTimer.stop();
+        if(stats){
+            stats->recordIteration({ClusteringAlgorithm::FuzzyCMeans, clustersNumber, loopIndex, -1, residual}, iterationDistanceEvaluations);
+        }
+        if(residual <= options.tolerance){
+            converged = true;
+            break;
+        }
+    }
+    if(stats){
+        stats->recordRun(converged);
+    }
+}
+
+/*!
+ * @brief       Sums the distances between the datapoints and their centroids over each cluster into workspace.clustersScatter
+ * @param[in]   assignmentDistances The value of the metric between each datapoint and its centroid
+ * @param[in]   labels              The index of the cluster of each datapoint
+ * @param[in]   clustersNumber      The number of clusters
+ * @param[in]   workspace           The scratch buffers
+*/
+inline void accumulateClustersScatter(
+        const Ref<const VectorXf>   &assignmentDistances,
+        const Ref<const VectorXi>   &labels,
+        int                         clustersNumber,
+        KmeansWorkspace             &workspace
+    ){
+    auto clustersScatter = storageView<VectorXf>(workspace.clustersScatter, clustersNumber, 1);
+    clustersScatter.setZero();
+    for(int j=0;j<labels.size();++j){
+        clustersScatter(labels(j)) += assignmentDistances(j);
+    }
+}
+
+/*!
+ * @brief       Computes the Davies-Bouldin index from the sums of the distances between the datapoints and their centroids, without going over the datapoints again
+ * @param[in]   centroids       The centroids of the clusters
+ * @param[in]   clustersScatter The sum of the metric between the datapoints of each cluster and its centroid, as accumulateClustersScatter() computes it
+ * @param[in]   counts          The number of datapoints in each cluster
+ * @param[in]   metric          The metric functor you want to use
+ * @param[in]   workspace       The scratch buffers
+ * @return      The Davies-Bouldin index
+*/
+template<typename Metric>
+float daviesBouldinIndexFromScatter(
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXf>    &clustersScatter,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        KmeansWorkspace              &workspace
+    ){
+    const int clustersNumber = centroids.rows();
+    PhaseTimer scoringTimer(workspace.stats, ClusteringPhase::Scoring);
+    if(workspace.stats){
+        workspace.stats->addDistanceEvaluations((long long)clustersNumber * (clustersNumber - 1) / 2);
+    }
+    auto clustersRatios = storageView<VectorXf>(workspace.clustersRatios, clustersNumber, 1);
+    clustersRatios.setZero();
+    //The ratios are symmetric, so each pair of clusters is only visited once and updates the largest ratio of both
+    for(int i=0;i<clustersNumber;++i){
+        const float scatterI = std::sqrt(clustersScatter(i) / float(counts(i)));
+        for(int l=i+1;l<clustersNumber;++l){
+            const float scatterL = std::sqrt(clustersScatter(l) / float(counts(l)));
+            const float ratio = (scatterI + scatterL) / std::sqrt(metric(centroids.row(i), centroids.row(l)));
+            clustersRatios(i) = std::max(ratio, clustersRatios(i));
+            clustersRatios(l) = std::max(ratio, clustersRatios(l));
+        }
+    }
+    return clustersRatios.sum()/float(clustersNumber);
+}
+
+/*!
+ * @brief       Same as daviesBouldinIndex(), on the scatter and separation buffers of a kmeans workspace
+ * @param[in]   workspace   The scratch buffers
+*/
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        KmeansWorkspace              &workspace
+    ){
+    const int clustersNumber = centroids.rows();
+    PhaseTimer scoringTimer(workspace.stats, ClusteringPhase::Scoring);
+    if(workspace.stats){
+        workspace.stats->addDistanceEvaluations(entities.rows());
+    }
+    auto clustersScatter = storageView<VectorXf>(workspace.clustersScatter, clustersNumber, 1);
+    clustersScatter.setZero();
+    for(int j=0;j<entities.rows();++j){
+        clustersScatter(labels(j)) += metric(centroids.row(labels(j)), entities.row(j));
+    }
+    scoringTimer.stop();
+    return daviesBouldinIndexFromScatter(centroids, clustersScatter, counts, metric, workspace);
+}
+
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const MatrixXbR>   &weights,
+        const Metric                 &metric
+    ){
+    VectorXi labels(entities.rows());
+    VectorXi counts(centroids.rows());
+    booleanWeightsToLabels(weights, labels, counts);
+    return daviesBouldinIndex(entities, centroids, labels, counts, metric);
+}
+
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric
+    ){
+    KmeansWorkspace workspace;
+    return daviesBouldinIndex(entities, centroids, labels, counts, metric, workspace);
+}
+
+template<typename Metric>
+float daviesBouldinIndex(
+        const Ref<const MatrixXfR>   &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        ClusteringContext            &context
+    ){
+    return daviesBouldinIndex(entities, centroids, labels, counts, metric, context.sweepWorkspaces[0].kmeans);
+}
+
+template<typename Metric>
+void daviesBouldinIndices(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices
+    ){
+    auto context = ClusteringContext::create(nullptr, 1);
+    daviesBouldinIndices(entities, centroids, clustersNumbers, labels, metric, indices, *context);
+}
+
+template<typename Metric>
+void daviesBouldinIndices(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices,
+        ClusteringContext           &context
+    ){
+    const int clusterizationsNumber = clustersNumbers.size();
+    const int totalClustersNumber = clustersNumbers.sum();
+    const int entitiesNumber = entities.rows();
+    assert(entities.cols()==centroids.cols() && centroids.rows()==totalClustersNumber && "daviesBouldinIndices: the centroids don't match the clusters numbers\n");
+    assert(labels.rows()==entitiesNumber && labels.cols()==clusterizationsNumber && indices.size()==clusterizationsNumber && "daviesBouldinIndices: labels and indices have the wrong sizes\n");
+    //Each block of datapoints sums its distances into its own column, and the columns are added in order, so the result doesn't depend on the threads
+    const int blocksNumber = std::max((entitiesNumber + daviesBouldinBlockRows - 1) / daviesBouldinBlockRows, 1);
+    auto blocksScatter = storageView<MatrixXf>(context.blocksScatter, totalClustersNumber, blocksNumber);
+    auto blocksCounts = storageView<MatrixXi>(context.blocksCounts, totalClustersNumber, blocksNumber);
+    PhaseTimer scoringTimer(context.stats(), ClusteringPhase::Scoring);
+    if(context.stats()){
+        context.stats()->addDistanceEvaluations((long long)entitiesNumber * clusterizationsNumber);
+    }
+    context.threadPool().parallelFor(blocksNumber, [&](int block, int){
+        auto blockScatter = blocksScatter.col(block);
+        auto blockCounts = blocksCounts.col(block);
+        blockScatter.setZero();
+        blockCounts.setZero();
+        const int lastEntity = std::min((block + 1) * daviesBouldinBlockRows, entitiesNumber);
+        //Every clusterization is scored while the datapoint is in cache
+        for(int j=block * daviesBouldinBlockRows;j<lastEntity;++j){
+            int firstCluster = 0;
+            for(int c=0;c<clusterizationsNumber;++c){
+                const int cluster = firstCluster + labels(j, c);
+                blockScatter(cluster) += metric(centroids.row(cluster), entities.row(j));
+                ++blockCounts(cluster);
+                firstCluster += clustersNumbers(c);
+            }
+        }
+    });
+    for(int block=1;block<blocksNumber;++block){
+        blocksScatter.col(0) += blocksScatter.col(block);
+        blocksCounts.col(0) += blocksCounts.col(block);
+    }
+    scoringTimer.stop();
+    int firstCluster = 0;
+    for(int c=0;c<clusterizationsNumber;++c){
+        const int clustersNumber = clustersNumbers(c);
+        indices(c) = daviesBouldinIndexFromScatter(centroids.middleRows(firstCluster, clustersNumber), blocksScatter.col(0).segment(firstCluster, clustersNumber),
+                                                   blocksCounts.col(0).segment(firstCluster, clustersNumber), metric, context.sweepWorkspaces[0].kmeans);
+        firstCluster += clustersNumber;
+    }
+}
+
+/*!
+ * @brief       Averages the silhouettes of the datapoints of a hard clusterization, computed as options requires
+ * @param[in]   entities        The datapoints
+ * @param[in]   clusters        The centroids of the clusters
+ * @param[in]   labels          The index of the cluster of each datapoint
+ * @param[in]   entitiesWeights The weight of each datapoint in the average, or an empty vector for a plain average
+ * @param[in]   metric          The metric functor you want to use
+ * @param[in]   options         The mode and sampling parameters, the threading ones are replaced by the context's
+ * @param[in]   context         The scratch buffers and thread pool
+ * @return      The weighted average of the silhouettes
+*/
+template<typename Metric>
+float averageSilhouette(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Ref<const VectorXf>   &entitiesWeights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+    ){
+    assert(labels.size()==entities.rows() && (entitiesWeights.size()==0 || entitiesWeights.size()==entities.rows()) && "silhouetteTest: incompatible sizes\n");
+    const int statsNumber = entities.cols();
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = clusters.rows();
+    const bool weighted = entitiesWeights.size() > 0;
+    SilhouetteWorkspace &workspace = context.silhouette;
+    ClusteringStats *stats = context.stats();
+    PhaseTimer scoringTimer(stats, ClusteringPhase::Scoring);
+    auto average = [](const Ref<const VectorXf> &silhouettes, const Ref<const VectorXf> &averageWeights){
+        if(averageWeights.size()==0){
+            return float(silhouettes.cast<double>().mean());
+        }
+        const double totalWeight = averageWeights.cast<double>().sum();
+        return totalWeight > 0 ? float(silhouettes.cast<double>().dot(averageWeights.cast<double>()) / totalWeight) : 0.f;
+    };
+    if(options.mode==SilhouetteMode::Simplified){
+        auto silhouettes = storageView<VectorXf>(workspace.silhouettes, entitiesNumber, 1);
+        auto entitiesSquaredNorms = storageView<VectorXf>(workspace.entitiesSquaredNorms, entitiesNumber, 1);
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            entitiesSquaredNorms = entities.rowwise().squaredNorm();
+        }
+        simplifiedSilhouettes(entities, entitiesSquaredNorms, clusters, labels, metric, context.sweepWorkspaces[0].kmeans.distances, silhouettes);
+        if(stats){
+            stats->addDistanceEvaluations((long long)entitiesNumber * clustersNumber);
+        }
+        return average(silhouettes, entitiesWeights);
+    }
+    auto counts = storageView<VectorXi>(workspace.counts, clustersNumber, 1);
+    counts.setZero();
+    if(options.mode==SilhouetteMode::Sampled && options.sampleSize < entitiesNumber){
+        //The sample is drawn without replacement through a partial Fisher-Yates shuffle, then sorted to read the datapoints in order
+        const int sampleSize = options.sampleSize;
+        FixedSeedSequence<2> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32)}};
+        std::mt19937 generator(seeds);
+        std::vector<int> &sampleIndices = workspace.sampleIndices;
+        sampleIndices.resize(entitiesNumber);
+        std::iota(sampleIndices.begin(), sampleIndices.end(), 0);
+        for(int l=0;l<sampleSize;++l){
+            std::swap(sampleIndices[l], sampleIndices[std::uniform_int_distribution<>(l, entitiesNumber - 1)(generator)]);
+        }
+        sampleIndices.resize(sampleSize);
+        std::sort(sampleIndices.begin(), sampleIndices.end());
+        auto sampleEntities = storageView<MatrixXfR>(workspace.sampleEntities, sampleSize, statsNumber);
+        auto sampleLabels = storageView<VectorXi>(workspace.sampleLabels, sampleSize, 1);
+        auto averageWeights = storageView<VectorXf>(workspace.averageWeights, weighted ? sampleSize : 0, 1);
+        for(int l=0;l<sampleSize;++l){
+            sampleEntities.row(l) = entities.row(sampleIndices[l]);
+            sampleLabels(l) = labels(sampleIndices[l]);
+            ++counts(sampleLabels(l));
+            if(weighted){
+                averageWeights(l) = entitiesWeights(sampleIndices[l]);
+            }
+        }
+        auto sampleSquaredNorms = storageView<VectorXf>(workspace.entitiesSquaredNorms, sampleSize, 1);
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            sampleSquaredNorms = sampleEntities.rowwise().squaredNorm();
+        }
+        auto silhouettes = storageView<VectorXf>(workspace.silhouettes, sampleSize, 1);
+        exactSilhouettes(sampleEntities, sampleSquaredNorms, sampleLabels, counts, metric, context.threadPool(), workspace, silhouettes);
+        if(stats){
+            stats->addDistanceEvaluations((long long)sampleSize * sampleSize);
+        }
+        return average(silhouettes, averageWeights);
+    }
+    for(int j=0;j<entitiesNumber;++j){
+        ++counts(labels(j));
+    }
+    auto entitiesSquaredNorms = storageView<VectorXf>(workspace.entitiesSquaredNorms, entitiesNumber, 1);
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        entitiesSquaredNorms = entities.rowwise().squaredNorm();
+    }
+    auto silhouettes = storageView<VectorXf>(workspace.silhouettes, entitiesNumber, 1);
+    exactSilhouettes(entities, entitiesSquaredNorms, labels, counts, metric, context.threadPool(), workspace, silhouettes);
+    if(stats){
+        stats->addDistanceEvaluations((long long)entitiesNumber * entitiesNumber);
+    }
+    return average(silhouettes, entitiesWeights);
+}
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric
+        ){
+    return silhouetteTest(entities, clusters, weights, metric, SilhouetteOptions());
+}
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options
+        ){
+    auto context = ClusteringContext::create(options.threadPool, options.threadsNumber);
+    return silhouetteTest(entities, clusters, weights, metric, options, *context);
+}
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        ){
+    assert(weights.rows()==clusters.rows() && weights.cols()==entities.rows() && "silhouetteTest: incompatible matrix sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = clusters.rows();
+    if(clustersNumber < 2){
+        return 0.;
+    }
+    //Each datapoint goes to its highest weight, and counts in the average as much as it's more attached to it than to the runner-up
+    auto labels = storageView<VectorXi>(context.silhouette.labels, entitiesNumber, 1);
+    auto weightsGaps = storageView<VectorXf>(context.silhouette.weightsGaps, entitiesNumber, 1);
+    for(int j=0;j<entitiesNumber;++j){
+        float firstWeight = -std::numeric_limits<float>::infinity();
+        float secondWeight = -std::numeric_limits<float>::infinity();
+        for(int i=0;i<clustersNumber;++i){
+            if(weights(i, j) > firstWeight){
+                secondWeight = firstWeight;
+                firstWeight = weights(i, j);
+                labels(j) = i;
+            }else if(weights(i, j) > secondWeight){
+                secondWeight = weights(i, j);
+            }
+        }
+        weightsGaps(j) = firstWeight - secondWeight;
+    }
+    return averageSilhouette(entities, clusters, labels, weightsGaps, metric, options, context);
+}
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options
+        ){
+    auto context = ClusteringContext::create(options.threadPool, options.threadsNumber);
+    return silhouetteTest(entities, clusters, labels, metric, options, *context);
+}
+
+template<typename Metric>
+float silhouetteTest(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+        ){
+    return averageSilhouette(entities, clusters, labels, VectorXf(), metric, options, context);
+}
+
+template<typename Metric>
+void calculateBooleanWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric
+    ){
+    VectorXi labels(entities.rows());
+    calculateLabels(entities, centroids, labels, metric);
+    labelsToBooleanWeights(labels, weights);
+}
+
+/*!
+ * @brief       Assigns every datapoint to its closest centroid, through the batched distance engines for the squared euclidean and manhattan metrics
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in-out] labels                The index of the closest centroid to each datapoint
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   workspace               The buffers of the distance engine
+ * @param[out]  nearestDistances        If not null, filled with the value of the metric between each datapoint and its closest centroid
+ * @return      The number of labels that changed
+*/
+template<typename Metric>
+int assignLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXf>               *nearestDistances
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        return squaredEuclideanLabels(entities, entitiesSquaredNorms, centroids, workspace, labels, nearestDistances);
+    }
+    if(useSimdPanel<Metric>(entities.cols(), centroids.rows())){
+        return panelLabels(entities, centroids, simdPanelArgmin<Metric>(), workspace, labels, nearestDistances);
+    }
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    int changedLabels = 0;
+    for(int j=0;j<entitiesNumber;j++){
+        float minDistance = metric(centroids.row(0), entities.row(j));
+        int minIndex = 0;
+        for(int i=1;i<clustersNumber;i++){
+            float currentDistance = metric(centroids.row(i), entities.row(j));
+            if(currentDistance < minDistance){
+                minDistance = currentDistance;
+                minIndex = i;
+            }
+        }
+        changedLabels += labels(j)!=minIndex;
+        labels(j) = minIndex;
+        if(nearestDistances){
+            (*nearestDistances)(j) = minDistance;
+        }
+    }
+    return changedLabels;
+}
+
+template<typename Metric>
+int calculateLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric
+    ){
+    ClusteringContext context;
+    return calculateLabels(entities, centroids, labels, metric, context);
+}
+
+template<typename Metric>
+int calculateLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        ClusteringContext           &context
+    ){
+    PhaseTimer assignmentTimer(context.stats(), ClusteringPhase::Assignment);
+    if(context.stats()){
+        context.stats()->addDistanceEvaluations((long long)entities.rows() * centroids.rows());
+    }
+    return assignLabels(entities, contextSquaredNorms<Metric>(entities, context), centroids, labels, metric, context.sweepWorkspaces[0].kmeans.distances, nullptr);
+}
+
+/*!
+ * @brief       Same as kmeansGenerator(), on precomputed squared norms and the buffers of a kmeans workspace, so that the runs of a sweep share them
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   workspace               The scratch buffers
+*/
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options,
+        KmeansWorkspace             &workspace
+    ){
+    assert(entities.cols()==centroids.cols() && "Called cmeansGenerator with entities and centroids having different dimensions\n");
+    assert(labels.size()==entities.rows() && counts.size()==centroids.rows() && "kmeansGenerator: labels and counts have the wrong sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    ClusteringStats *stats = workspace.stats;
+    //The distances of the last assignment are kept, so that the scatter of the clusters comes for free to daviesBouldinIndexFromScatter()
+    auto assignmentDistancesVector = storageView<VectorXf>(workspace.assignmentDistances, entities.rows(), 1);
+    Ref<VectorXf> assignmentDistances(assignmentDistancesVector);
+    auto assignEntities = [&](){
+        return assignLabels(entities, entitiesSquaredNorms, centroids, labels, metric, workspace.distances, &assignmentDistances);
+    };
+    //Unless they're provided, we initialize the centroids with some datapoints that are spread out across the dataset, according to the kmeans++ algorithm or its scalable variant
+    PhaseTimer initializationTimer(stats, ClusteringPhase::Initialization);
+    if(options.initialization==KmeansInitialization::KmeansParallel){
+        kmeansParallelInitializer(entities, entitiesSquaredNorms, centroids, metric, generator, options.oversamplingFactor, options.parallelRounds, workspace);
+    }else if(options.initialization==KmeansInitialization::KmeansPlusPlus){
+        kmeansPlusPlusInitializer(entities, entitiesSquaredNorms, centroids, metric, generator, workspace);
+    }
+    initializationTimer.stop();
+    KmeansAlgorithm algorithm = options.algorithm;
+    if(algorithm==KmeansAlgorithm::Automatic){
+        algorithm = clustersNumber <= hamerlyMaxClustersNumber ? KmeansAlgorithm::Hamerly : KmeansAlgorithm::Elkan;
+    }
+    bool boundedAlgorithm = false;
+    if constexpr(MetricTraits<Metric>::satisfiesTriangleInequality){
+        boundedAlgorithm = algorithm!=KmeansAlgorithm::Lloyd;
+    }
+    if(boundedAlgorithm){
+        if constexpr(MetricTraits<Metric>::satisfiesTriangleInequality){
+            const bool converged = algorithm==KmeansAlgorithm::Hamerly ? hamerlyKmeans(entities, centroids, labels, counts, metric, entitiesSquaredNorms, workspace)
+                                                                       : elkanKmeans(entities, centroids, labels, counts, metric, entitiesSquaredNorms, workspace);
+            //An empty cluster interrupts the bounded algorithms, the Lloyd loop takes over from their last assignment
+            if(converged){
+                //The bounds skipped most distances in the last iterations, so those to the final centroids take one more pass
+                PhaseTimer scoringTimer(stats, ClusteringPhase::Scoring);
+                for(int j=0;j<entitiesNumber;++j){
+                    assignmentDistances(j) = metric(centroids.row(labels(j)), entities.row(j));
+                }
+                accumulateClustersScatter(assignmentDistances, labels, clustersNumber, workspace);
+                if(stats){
+                    stats->addDistanceEvaluations(entitiesNumber);
+                    stats->recordRun(true);
+                }
+                return;
+            }
+        }
+    }else{
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        assignEntities();
+        if(stats){
+            stats->addDistanceEvaluations((long long)entitiesNumber * clustersNumber);
+        }
+    }
+    //Converged when an assignment doesn't move any datapoint, so the centroids are the means of their clusters
+    for(int iteration=0;;++iteration){
+        PhaseTimer updateTimer(stats, ClusteringPhase::Update);
+        auto oldCentroids = storageView<MatrixXf>(workspace.oldCentroids, stats ? clustersNumber : 0, centroids.cols());
+        if(stats){
+            oldCentroids = centroids;
+        }
+        if(!updateCentroidsFromLabels(entities, labels, centroids, counts) && stats){
+            stats->recordEmptyCluster();
+        }
+        updateTimer.stop();
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        const int changedLabels = assignEntities();
+        assignmentTimer.stop();
+        if(stats){
+            float maxShift = 0;
+            for(int i=0;i<clustersNumber;++i){
+                maxShift = std::max(maxShift, MetricTraits<Metric>::metricDistance(metric(oldCentroids.row(i), centroids.row(i))));
+            }
+            stats->recordIteration({ClusteringAlgorithm::Lloyd, clustersNumber, iteration, changedLabels, maxShift}, (long long)entitiesNumber * clustersNumber);
+        }
+        if(changedLabels==0){
+            break;
+        }
+    }
+    accumulateClustersScatter(assignmentDistances, labels, clustersNumber, workspace);
+    if(stats){
+        stats->recordRun(true);
+    }
+}
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric
+    ){
+    std::random_device rd;
+    std::mt19937 generator(rd());
+    kmeansGenerator(entities, centroids, weights, metric, generator);
+}
+
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric,
+        std::mt19937                &generator
+    ){
+    kmeansGenerator(entities, centroids, weights, metric, generator, KmeansOptions());
+}
+
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXbR>              weights,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options
+    ){
+    VectorXi labels(entities.rows());
+    VectorXi counts(centroids.rows());
+    kmeansGenerator(entities, centroids, labels, counts, metric, generator, options);
+    labelsToBooleanWeights(labels, weights);
+}
+
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options
+    ){
+    ClusteringContext context;
+    kmeansGenerator(entities, centroids, labels, counts, metric, generator, options, context);
+}
+
+template<typename Metric>
+void kmeansGenerator(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options,
+        ClusteringContext           &context
+    ){
+    kmeansGenerator(entities, contextSquaredNorms<Metric>(entities, context), centroids, labels, counts, metric, generator, options, context.sweepWorkspaces[0].kmeans);
+}
+
+
+/*!
+ * @brief       Reads the next chunk of a streaming source into the chunk buffer
+ * @param[in]   source      The source of the datapoints
+ * @param[in]   chunk       The chunk buffer
+ * @return      The number of datapoints read, 0 at the end of the dataset
+*/
+template<typename ChunkSource>
+int readChunk(
+        ChunkSource                 &source,
+        Ref<MatrixXfR>              chunk
+    ){
+    const int chunkRows = source(chunk);
+    assert(chunkRows>=0 && chunkRows<=chunk.rows() && "streaming source: returned more datapoints than the chunk holds\n");
+    return chunkRows;
+}
+
+template<typename Metric, typename ChunkSource>
+int streamingKmeansGenerator(
+        ChunkSource                     &&source,
+        Ref<MatrixXf>                   centroids,
+        Ref<VectorXi>                   counts,
+        const Metric                    &metric,
+        std::mt19937                    &generator,
+        const StreamingKmeansOptions    &options
+    ){
+    ClusteringContext context;
+    return streamingKmeansGenerator(source, centroids, counts, metric, generator, options, context);
+}
+
+template<typename Metric, typename ChunkSource>
+int streamingKmeansGenerator(
+        ChunkSource                     &&source,
+        Ref<MatrixXf>                   centroids,
+        Ref<VectorXi>                   counts,
+        const Metric                    &metric,
+        std::mt19937                    &generator,
+        const StreamingKmeansOptions    &options,
+        ClusteringContext               &context
+    ){
+    assert(counts.size()==centroids.rows() && options.chunkSize > 0 && "streamingKmeansGenerator: incompatible sizes\n");
+    const int statsNumber = centroids.cols();
+    const int clustersNumber = centroids.rows();
+    StreamingWorkspace &workspace = context.streaming;
+    auto chunk = storageView<MatrixXfR>(workspace.chunk, options.chunkSize, statsNumber);
+    auto centroidsSums = storageView<MatrixXf>(workspace.centroidsSums, clustersNumber, statsNumber);
+    auto chunkCounts = storageView<VectorXi>(workspace.chunkCounts, clustersNumber, 1);
+    auto centroidsWeights = storageView<VectorXd>(workspace.centroidsWeights, clustersNumber, 1);
+    auto passCentroids = storageView<MatrixXf>(workspace.passCentroids, clustersNumber, statsNumber);
+    auto chunkSquaredNorms = [&](int chunkRows){
+        auto entitiesSquaredNorms = storageView<VectorXf>(workspace.chunkSquaredNorms, chunkRows, 1);
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            entitiesSquaredNorms = chunk.topRows(chunkRows).rowwise().squaredNorm();
+        }
+        return entitiesSquaredNorms;
+    };
+    ClusteringStats *stats = context.stats();
+    int chunkRows = readChunk(source, chunk);
+    //The seeding is drawn from the first chunk, which is then the first mini-batch
+    PhaseTimer initializationTimer(stats, ClusteringPhase::Initialization);
+    if(options.kmeans.initialization!=KmeansInitialization::Provided){
+        assert(chunkRows>=clustersNumber && "streamingKmeansGenerator: the first chunk holds less datapoints than clusters\n");
+        const auto entitiesSquaredNorms = chunkSquaredNorms(chunkRows);
+        if(options.kmeans.initialization==KmeansInitialization::KmeansParallel){
+            kmeansParallelInitializer(chunk.topRows(chunkRows), entitiesSquaredNorms, centroids, metric, generator, options.kmeans.oversamplingFactor, options.kmeans.parallelRounds, workspace.kmeans);
+        }else{
+            kmeansPlusPlusInitializer(chunk.topRows(chunkRows), entitiesSquaredNorms, centroids, metric, generator, workspace.kmeans);
+        }
+    }
+    initializationTimer.stop();
+    centroidsWeights.setZero();
+    int passes = 0;
+    bool converged = false;
+    while(passes < options.maxPasses){
+        passCentroids = centroids;
+        counts.setZero();
+        if(passes > 0){
+            chunkRows = readChunk(source, chunk);
+        }
+        if(chunkRows==0){
+            break;
+        }
+        long long passDistanceEvaluations = 0;
+        for(;chunkRows>0;chunkRows=readChunk(source, chunk)){
+            PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+            const auto entitiesSquaredNorms = chunkSquaredNorms(chunkRows);
+            auto chunkLabels = storageView<VectorXi>(workspace.chunkLabels, chunkRows, 1);
+            assignLabels(chunk.topRows(chunkRows), entitiesSquaredNorms, centroids, chunkLabels, metric, workspace.kmeans.distances, nullptr);
+            passDistanceEvaluations += (long long)chunkRows * clustersNumber;
+            assignmentTimer.stop();
+            PhaseTimer updateTimer(stats, ClusteringPhase::Update);
+            miniBatchUpdate(chunk.topRows(chunkRows), chunkLabels, centroids, centroidsWeights, centroidsSums, chunkCounts);
+            counts += chunkCounts;
+        }
+        const float residual = (centroids - passCentroids).squaredNorm() / passCentroids.squaredNorm();
+        if(stats){
+            stats->recordIteration({ClusteringAlgorithm::MiniBatch, clustersNumber, passes, -1, residual}, passDistanceEvaluations);
+        }
+        ++passes;
+        if((centroids - passCentroids).squaredNorm() <= options.tolerance * passCentroids.squaredNorm()){
+            converged = true;
+            break;
+        }
+    }
+    if(stats){
+        stats->recordRun(converged);
+    }
+    return passes;
+}
+
+template<typename Metric, typename ChunkSource, typename LabelsSink>
+Index streamingCalculateLabels(
+        ChunkSource                     &&source,
+        const Ref<const MatrixXf>       &centroids,
+        const Metric                    &metric,
+        LabelsSink                      &&labelsSink,
+        const StreamingKmeansOptions    &options
+    ){
+    ClusteringContext context;
+    return streamingCalculateLabels(source, centroids, metric, labelsSink, options, context);
+}
+
+template<typename Metric, typename ChunkSource, typename LabelsSink>
+Index streamingCalculateLabels(
+        ChunkSource                     &&source,
+        const Ref<const MatrixXf>       &centroids,
+        const Metric                    &metric,
+        LabelsSink                      &&labelsSink,
+        const StreamingKmeansOptions    &options,
+        ClusteringContext               &context
+    ){
+    assert(options.chunkSize > 0 && "streamingCalculateLabels: the chunks must hold at least one datapoint\n");
+    StreamingWorkspace &workspace = context.streaming;
+    auto chunk = storageView<MatrixXfR>(workspace.chunk, options.chunkSize, centroids.cols());
+    Index firstEntity = 0;
+    for(int chunkRows=readChunk(source, chunk);chunkRows>0;chunkRows=readChunk(source, chunk)){
+        PhaseTimer assignmentTimer(context.stats(), ClusteringPhase::Assignment);
+        auto entitiesSquaredNorms = storageView<VectorXf>(workspace.chunkSquaredNorms, chunkRows, 1);
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            entitiesSquaredNorms = chunk.topRows(chunkRows).rowwise().squaredNorm();
+        }
+        auto chunkLabels = storageView<VectorXi>(workspace.chunkLabels, chunkRows, 1);
+        assignLabels(chunk.topRows(chunkRows), entitiesSquaredNorms, centroids, chunkLabels, metric, workspace.kmeans.distances, nullptr);
+        assignmentTimer.stop();
+        const Ref<const VectorXi> labels = chunkLabels;
+        labelsSink(firstEntity, labels);
+        firstEntity += chunkRows;
+    }
+    if(context.stats()){
+        context.stats()->addDistanceEvaluations((long long)firstEntity * centroids.rows());
+    }
+    return firstEntity;
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<MatrixXbR>              boolWeights,
+        const Metric                &metric
+    ){
+    SweepOptions options;
+    std::random_device rd;
+    options.seed = (static_cast<unsigned long long>(rd()) << 32) | rd();
+    return clusterGeneratorApproximate(entities, centroids, weights, boolWeights, metric, options);
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<MatrixXbR>              boolWeights,
+        const Metric                &metric,
+        const SweepOptions          &options
+    ){
+    VectorXi labels = VectorXi::Constant(entities.rows(), -1);
+    const int clustersNumber = clusterGeneratorApproximate(entities, centroids, weights, labels, metric, options);
+    if(labels(0)>=0){
+        labelsToBooleanWeights(labels, boolWeights.topRows(clustersNumber));
+    }
+    return clustersNumber;
+}
+
+/*!
+ * @brief       Returns how many lower bounds per datapoint the kmeansGenerator() runs with up to maxClustersNumber clusters keep, see KmeansWorkspace::reserve()
+ * @param[in]   options             The parameters of the runs
+ * @param[in]   maxClustersNumber   The largest number of clusters of the runs
+ * @return      0 if the runs only use Lloyd, 1 if Hamerly is the only bounded algorithm they can use, maxClustersNumber if they can use Elkan
+*/
+template<typename Metric>
+int kmeansLowerBoundsNumber(
+        const KmeansOptions &options,
+        int                 maxClustersNumber
+    ){
+    if constexpr(!MetricTraits<Metric>::satisfiesTriangleInequality){
+        return 0;
+    }else if(options.algorithm==KmeansAlgorithm::Elkan || (options.algorithm==KmeansAlgorithm::Automatic && maxClustersNumber > hamerlyMaxClustersNumber)){
+        return maxClustersNumber;
+    }else{
+        return options.algorithm==KmeansAlgorithm::Lloyd ? 0 : 1;
+    }
+}
+
+/*!
+ * @brief       The sweep of clusterGeneratorApproximate() where every (clusters number, attempt) run starts from its own seeding
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[out]  centroids               The centroids of the best run
+ * @param[out]  labels                  The index of the cluster of each datapoint in the best run
+ * @param[out]  counts                  The number of datapoints in each cluster of the best run
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   options                 The parameters of the sweep
+ * @param[in]   context                 The scratch buffers of the workers and the pool the runs are spread over
+ * @return      The number of clusters of the best run, 0 if no run had a valid fitness
+*/
+template<typename Metric>
+int independentClustersSweep(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    const int statsNumber = entities.cols();
+    const int entitiesNumber = entities.rows();
+    const int maxClustersNumber = centroids.rows();
+    //Every worker keeps the buffers of the run it's doing and the best result it has seen so far.
+    //They're sized for the largest run up front, as which runs a worker gets depends on the scheduling
+    const int candidatesNumber = options.kmeans.initialization==KmeansInitialization::KmeansParallel
+                               ? int(2.f * (1.f + options.kmeans.oversamplingFactor * float(maxClustersNumber) * float(options.kmeans.parallelRounds))) : 0;
+    for(SweepWorkspace &workspace : context.sweepWorkspaces){
+        workspace.reserve(entitiesNumber, statsNumber, maxClustersNumber, candidatesNumber,
+                          options.kmeans.initialization!=KmeansInitialization::Provided, kmeansLowerBoundsNumber<Metric>(options.kmeans, maxClustersNumber));
+        workspace.bestFitness = 50.;
+        workspace.bestJob = -1;
+    }
+    //The minimum amount of clusters is 2 because otherwise the Davies-Bouldin index fails
+    const int jobsNumber = std::max(maxClustersNumber - 1, 0) * attemptsPerClustersNumber;
+    ClusteringStats *stats = context.stats();
+    const size_t firstFitness = stats ? stats->clustersFitness.size() : 0;
+    context.threadPool().parallelFor(jobsNumber, [&](int jobIndex, int workerIndex){
+        //Jobs are numbered from the highest number of clusters down, as those are the most expensive ones and should start first
+        const int currentClustersNumber = maxClustersNumber - jobIndex / attemptsPerClustersNumber;
+        const int attempt = jobIndex % attemptsPerClustersNumber;
+        //The position of this run in a serial sweep, used to break ties
+        const int serialJob = (currentClustersNumber - 2) * attemptsPerClustersNumber + attempt;
+        SweepWorkspace &workspace = context.sweepWorkspaces[workerIndex];
+        auto clustersCandidate  = storageView<MatrixXf>(workspace.currentClusters, currentClustersNumber, statsNumber);
+        auto labelsCandidate    = storageView<VectorXi>(workspace.currentLabels, entitiesNumber, 1);
+        auto countsCandidate    = storageView<VectorXi>(workspace.currentCounts, currentClustersNumber, 1);
+        FixedSeedSequence<4> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32), std::uint32_t(currentClustersNumber), std::uint32_t(attempt)}};
+        std::mt19937 generator(seeds);
+        float newFitness;
+        int iterations = 0;
+        do{
+            kmeansGenerator(entities, entitiesSquaredNorms, clustersCandidate, labelsCandidate, countsCandidate, metric, generator, options.kmeans, workspace.kmeans);
+            newFitness = daviesBouldinIndexFromScatter(clustersCandidate, storageView<VectorXf>(workspace.kmeans.clustersScatter, currentClustersNumber, 1), countsCandidate, metric, workspace.kmeans);
+            ++iterations;
+        }while(std::isnan(newFitness) && iterations < maxIterationPerClustersNumber);
+        if(stats){
+            stats->recordFitness({currentClustersNumber, attempt, iterations - 1, newFitness});
+        }
+        if(newFitness < workspace.bestFitness || (newFitness==workspace.bestFitness && workspace.bestJob>=0 && serialJob < workspace.bestJob)){
+            storageView<MatrixXf>(workspace.bestClusters, currentClustersNumber, statsNumber)   = clustersCandidate;
+            storageView<VectorXi>(workspace.bestCounts, currentClustersNumber, 1)              = countsCandidate;
+            workspace.bestLabels.swap(workspace.currentLabels);
+            workspace.bestFitness                                                               = newFitness;
+            workspace.bestJob                                                                   = serialJob;
+            workspace.bestClustersNumber                                                        = currentClustersNumber;
+        }
+    });
+    if(stats){
+        stats->sortClustersFitness(firstFitness);
+    }
+    SweepWorkspace *bestWorkspace = nullptr;
+    for(SweepWorkspace &workspace : context.sweepWorkspaces){
+        if(workspace.bestJob<0){
+            continue;
+        }
+        if(!bestWorkspace || workspace.bestFitness < bestWorkspace->bestFitness || (workspace.bestFitness==bestWorkspace->bestFitness && workspace.bestJob < bestWorkspace->bestJob)){
+            bestWorkspace = &workspace;
+        }
+    }
+    if(!bestWorkspace){
+        return 0;
+    }
+    const int clustersNumber = bestWorkspace->bestClustersNumber;
+    centroids.topRows(clustersNumber) = storageView<MatrixXf>(bestWorkspace->bestClusters, clustersNumber, statsNumber);
+    counts.head(clustersNumber) = storageView<VectorXi>(bestWorkspace->bestCounts, clustersNumber, 1);
+    labels = storageView<VectorXi>(bestWorkspace->bestLabels, entitiesNumber, 1);
+    return clustersNumber;
+}
+
+/*!
+ * @brief       The sweep of clusterGeneratorApproximate() with SweepOptions::warmStart, where each number of clusters starts from the best solution of the previous one
+ * @details     The k-1 solution (initially the whole dataset as a single cluster) is turned into k centroids in one of two ways:
+ *              the first attempt splits the cluster with the highest scatter in two, moving the copies of its centroid apart by one standard deviation
+ *              of the cluster along each dimension, the other attempts add one kmeans++ center, drawn with probability proportional to the distance D(x)
+ *              between each datapoint and its k-1 centroid. D(x) and the scatters are computed once per number of clusters and shared by the attempts.
+ *              If all the attempts of a number of clusters fail, the next one starts from its own seeding.
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[out]  centroids               The centroids of the best run
+ * @param[out]  labels                  The index of the cluster of each datapoint in the best run
+ * @param[out]  counts                  The number of datapoints in each cluster of the best run
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   options                 The parameters of the sweep
+ * @param[in]   context                 The scratch buffers of the attempts and the pool they're spread over
+ * @return      The number of clusters of the best run, 0 if no run had a valid fitness
+*/
+template<typename Metric>
+int warmStartedClustersSweep(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    const int statsNumber = entities.cols();
+    const int entitiesNumber = entities.rows();
+    const int maxClustersNumber = centroids.rows();
+    //Every attempt of the current number of clusters keeps its own buffers, so the best one can be picked in serial order
+    std::vector<SweepWorkspace> &workspaces = context.attemptsWorkspaces;
+    if(int(workspaces.size()) < attemptsPerClustersNumber){
+        workspaces.resize(attemptsPerClustersNumber);
+        for(SweepWorkspace &workspace : workspaces){
+            workspace.kmeans.stats = context.stats();
+        }
+    }
+    ClusteringStats *stats = context.stats();
+    auto baseClusters = storageView<MatrixXf>(context.baseClusters, maxClustersNumber, statsNumber);
+    storageView<VectorXi>(context.baseLabels, entitiesNumber, 1).setZero();
+    baseClusters.row(0) = entities.colwise().mean();
+    int baseClustersNumber = 1;
+    //D(x) and the scatter of the base solution. Those of the single cluster are computed here, the later ones come from the kmeansGenerator() run that found them
+    auto clustersScatter = storageView<VectorXf>(context.clustersScatter, maxClustersNumber, 1);
+    {
+        auto nearestDistances = storageView<VectorXf>(context.nearestDistances, entitiesNumber, 1);
+        for(int j=0;j<entitiesNumber;++j){
+            nearestDistances(j) = metric(baseClusters.row(0), entities.row(j));
+        }
+        clustersScatter(0) = nearestDistances.sum();
+    }
+    auto splitOffset = storageView<RowVectorXf>(context.splitOffset, 1, statsNumber);
+    KmeansOptions warmOptions = options.kmeans;
+    warmOptions.initialization = KmeansInitialization::Provided;
+    float bestFitness = 50.;
+    int bestClustersNumber = 0;
+    for(int currentClustersNumber=2;currentClustersNumber<=maxClustersNumber;++currentClustersNumber){
+        const bool warm = baseClustersNumber==currentClustersNumber - 1;
+        int splitCluster = 0;
+        //The labels and D(x) buffers are swapped with the best attempt's, so the views are taken anew for every number of clusters
+        const auto nearestDistances = storageView<VectorXf>(context.nearestDistances, entitiesNumber, 1);
+        if(warm){
+            const auto baseLabels = storageView<VectorXi>(context.baseLabels, entitiesNumber, 1);
+            clustersScatter.head(baseClustersNumber).maxCoeff(&splitCluster);
+            splitOffset.setZero();
+            int splitCount = 0;
+            for(int j=0;j<entitiesNumber;++j){
+                if(baseLabels(j)==splitCluster){
+                    splitOffset += (entities.row(j) - baseClusters.row(splitCluster)).cwiseAbs2();
+                    ++splitCount;
+                }
+            }
+            splitOffset = (splitOffset / float(std::max(splitCount, 1))).cwiseSqrt();
+        }
+        context.threadPool().parallelFor(attemptsPerClustersNumber, [&](int attempt, int){
+            SweepWorkspace &workspace = workspaces[attempt];
+            auto clustersCandidate  = storageView<MatrixXf>(workspace.currentClusters, currentClustersNumber, statsNumber);
+            auto labelsCandidate    = storageView<VectorXi>(workspace.currentLabels, entitiesNumber, 1);
+            auto countsCandidate    = storageView<VectorXi>(workspace.currentCounts, currentClustersNumber, 1);
+            FixedSeedSequence<4> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32), std::uint32_t(currentClustersNumber), std::uint32_t(attempt)}};
+            std::mt19937 generator(seeds);
+            float newFitness;
+            int iterations = 0;
+            do{
+                if(warm){
+                    clustersCandidate.topRows(currentClustersNumber - 1) = baseClusters.topRows(currentClustersNumber - 1);
+                    //A failed split is retried as a kmeans++ center
+                    if(attempt==0 && iterations==0){
+                        clustersCandidate.row(currentClustersNumber - 1) = baseClusters.row(splitCluster) + 0.5f * splitOffset;
+                        clustersCandidate.row(splitCluster) -= 0.5f * splitOffset;
+                    }else{
+                        clustersCandidate.row(currentClustersNumber - 1) = entities.row(drawProportionally(nearestDistances, generator));
+                    }
+                    kmeansGenerator(entities, entitiesSquaredNorms, clustersCandidate, labelsCandidate, countsCandidate, metric, generator, warmOptions, workspace.kmeans);
+                }else{
+                    kmeansGenerator(entities, entitiesSquaredNorms, clustersCandidate, labelsCandidate, countsCandidate, metric, generator, options.kmeans, workspace.kmeans);
+                }
+                newFitness = daviesBouldinIndexFromScatter(clustersCandidate, storageView<VectorXf>(workspace.kmeans.clustersScatter, currentClustersNumber, 1), countsCandidate, metric, workspace.kmeans);
+                ++iterations;
+            }while(std::isnan(newFitness) && iterations < maxIterationPerClustersNumber);
+            workspace.currentFitness = newFitness;
+            if(stats){
+                stats->recordFitness({currentClustersNumber, attempt, iterations - 1, newFitness});
+            }
+        });
+        if(stats){
+            stats->sortClustersFitness(stats->clustersFitness.size() - attemptsPerClustersNumber);
+        }
+        //Ties go to the lowest attempt, as in a serial sweep
+        int bestAttempt = -1;
+        for(int attempt=0;attempt<attemptsPerClustersNumber;++attempt){
+            if(!std::isnan(workspaces[attempt].currentFitness) && (bestAttempt<0 || workspaces[attempt].currentFitness < workspaces[bestAttempt].currentFitness)){
+                bestAttempt = attempt;
+            }
+        }
+        if(bestAttempt<0){
+            continue;
+        }
+        SweepWorkspace &bestWorkspace = workspaces[bestAttempt];
+        baseClusters.topRows(currentClustersNumber) = storageView<MatrixXf>(bestWorkspace.currentClusters, currentClustersNumber, statsNumber);
+        context.baseLabels.swap(bestWorkspace.currentLabels);
+        context.nearestDistances.swap(bestWorkspace.kmeans.assignmentDistances);
+        clustersScatter.head(currentClustersNumber) = storageView<VectorXf>(bestWorkspace.kmeans.clustersScatter, currentClustersNumber, 1);
+        baseClustersNumber = currentClustersNumber;
+        if(bestWorkspace.currentFitness < bestFitness){
+            centroids.topRows(currentClustersNumber) = baseClusters.topRows(currentClustersNumber);
+            counts.head(currentClustersNumber) = storageView<VectorXi>(bestWorkspace.currentCounts, currentClustersNumber, 1);
+            labels = storageView<VectorXi>(context.baseLabels, entitiesNumber, 1);
+            bestFitness = bestWorkspace.currentFitness;
+            bestClustersNumber = currentClustersNumber;
+        }
+    }
+    return bestClustersNumber;
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options
+    ){
+    auto context = ClusteringContext::create(options.threadPool, options.threadsNumber);
+    return clusterGeneratorApproximate(entities, centroids, weights, labels, metric, options, *context);
+}
+
+/*!
+ * @brief       The sweep of clusterGeneratorApproximate(), up to the fuzzy weights which are left to the caller
+ * @return      The number of clusters found, 0 if no run had a valid fitness
+*/
+template<typename Metric>
+int approximateClustersSweep(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    assert(centroids.cols()==entities.cols() && "clusterGeneratorApproximate: called with entities and centroids having different sizes");
+    const int statsNumber = entities.cols();
+    const auto entitiesSquaredNorms = contextSquaredNorms<Metric>(entities, context);
+    auto counts = storageView<VectorXi>(context.counts, centroids.rows(), 1);
+    const int clustersNumber = options.warmStart ? warmStartedClustersSweep(entities, entitiesSquaredNorms, centroids, labels, counts, metric, options, context)
+                                                 : independentClustersSweep(entities, entitiesSquaredNorms, centroids, labels, counts, metric, options, context);
+    if(clustersNumber==0){
+        return 0;
+    }
+    //Single-datapoint clusters lead to infinite fuzzy weights, so we offset them by a small vector.
+    //The risk in doing this is that we might end up moving the centroid too much, so that its datapoint ends up in another cluster.
+    //So to avoid this, we scale our offsetConstant by the dataset's dimensionality.
+    //Additionally, we choose as a direction the one defined by the current vector and the average one the result is that we're pushing the centroid towards the center of the whole dataset,
+    //which makes it slightly harder for the worst case scenario to happen.
+    const float shiftMultiplier = offsetConstant / float(statsNumber);
+    auto averageEntity = storageView<RowVectorXf>(context.averageEntity, 1, statsNumber);
+    averageEntity = entities.colwise().mean();
+    for(int i=0;i<clustersNumber;++i){
+        if(counts(i)==1){
+            centroids.row(i) += shiftMultiplier * (centroids.row(i) - averageEntity);
+        }
+    }
+    return clustersNumber;
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    const int clustersNumber = approximateClustersSweep(entities, centroids, labels, metric, options, context);
+    if(clustersNumber==0){
+        return 2;
+    }
+    calculateFuzzyWeights(entities, centroids.topRows(clustersNumber), weights.topRows(clustersNumber), metric, context);
+    return clustersNumber;
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options
+    ){
+    auto context = ClusteringContext::create(options.threadPool, options.threadsNumber);
+    return clusterGeneratorApproximate(entities, centroids, weights, labels, metric, options, *context);
+}
+
+template<typename Metric>
+int clusterGeneratorApproximate(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    const int clustersNumber = approximateClustersSweep(entities, centroids, labels, metric, options, context);
+    if(clustersNumber==0){
+        return 2;
+    }
+    calculateFuzzyWeights(entities, centroids.topRows(clustersNumber), weights, metric, context);
+    return clustersNumber;
+}
+
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric
+    ){
+    SweepOptions options;
+    std::random_device rd;
+    options.seed = (static_cast<unsigned long long>(rd()) << 32) | rd();
+    return clusterGeneratorExact(entities, centroids, weights, metric, options);
+}
+
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options
+    ){
+    //The silhouette is the only part of the sweep that uses the thread pool
+    ThreadPool *threadPool = options.silhouette.threadPool ? options.silhouette.threadPool : options.threadPool;
+    const int threadsNumber = options.silhouette.mode==SilhouetteMode::Simplified ? 1 : options.silhouette.threadsNumber;
+    auto context = ClusteringContext::create(threadPool, threadsNumber);
+    return clusterGeneratorExact(entities, centroids, weights, metric, options, *context);
+}
+
+template<typename Metric>
+int clusterGeneratorExact(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    const int statsNumber = entities.cols();
+    const int entitiesNumber = entities.rows();
+    const int maxClustersNumber = centroids.rows();
+    if(weights.rows()!=maxClustersNumber || weights.cols()!=entitiesNumber){
+        weights.resize(maxClustersNumber, entitiesNumber);
+    }
+    float fitnessCandidate = -std::numeric_limits<float>::infinity();
+    float newFitness = 0;
+    int centroidsNumber = 2;
+    auto currentClustersCandidate = storageView<MatrixXf>(context.exactClusters, maxClustersNumber, statsNumber);
+    auto currentWeightsCandidate = storageView<MatrixXfR>(context.exactWeights, maxClustersNumber, entitiesNumber);
+    const auto entitiesSquaredNorms = contextSquaredNorms<Metric>(entities, context);
+    auto nearestDistances = storageView<VectorXf>(context.nearestDistances, entitiesNumber, 1);
+    const float shiftMultiplier = offsetConstant / float(statsNumber);
+    auto averageEntity = storageView<RowVectorXf>(context.averageEntity, 1, statsNumber);
+    averageEntity = entities.colwise().mean();
+    FixedSeedSequence<2> seeds{{std::uint32_t(options.seed), std::uint32_t(options.seed >> 32)}};
+    std::mt19937 generator(seeds);
+    FcmOptions fcmOptions = options.fcm;
+    for(int clustersNumber = 2; clustersNumber<=maxClustersNumber; ++clustersNumber){
+        auto clustersCandidate = currentClustersCandidate.topRows(clustersNumber);
+        auto weightsCandidate = currentWeightsCandidate.topRows(clustersNumber);
+        fcmOptions.initializeFromCentroids = options.warmStart && clustersNumber > 2;
+        fcmOptions.seed = options.seed + clustersNumber;
+        if(fcmOptions.initializeFromCentroids){
+            //The first rows still hold the centroids of the previous number of clusters, we add a kmeans++ center to them,
+            //offset towards the center of the dataset so that it doesn't coincide with its datapoint
+            nearestDistances.setConstant(std::numeric_limits<float>::infinity());
+            updateNearestDistances(entities, entitiesSquaredNorms, clustersCandidate.topRows(clustersNumber - 1), metric, context.sweepWorkspaces[0].kmeans.distances, nearestDistances);
+            clustersCandidate.row(clustersNumber - 1) = entities.row(drawProportionally(nearestDistances, generator));
+            clustersCandidate.row(clustersNumber - 1) += shiftMultiplier * (clustersCandidate.row(clustersNumber - 1) - averageEntity);
+        }
+        FCMGenerator(entities, clustersCandidate, weightsCandidate, metric, fcmOptions, context);
+        newFitness = silhouetteTest(entities, clustersCandidate, weightsCandidate, metric, options.silhouette, context);
+        if(context.stats()){
+            context.stats()->recordFitness({clustersNumber, 0, 0, newFitness});
+        }
+        if (newFitness > fitnessCandidate){
+            centroids.topRows(clustersNumber) = clustersCandidate;
+            weights.topRows(clustersNumber) = weightsCandidate;
+            fitnessCandidate = newFitness;
+            centroidsNumber = clustersNumber;
+        }
+    }
+    return centroidsNumber;
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void calculateFuzzyWeights(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+    ){
+    calculateFuzzyWeights(context.rowMajorEntities(entities), centroids, weights, metric, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void FCMGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    ){
+    FCMGenerator(context.rowMajorEntities(entities), centroids, weights, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+float daviesBouldinIndex(
+        const MatrixBase<Derived>    &entities,
+        const Ref<const MatrixXf>    &centroids,
+        const Ref<const VectorXi>    &labels,
+        const Ref<const VectorXi>    &counts,
+        const Metric                 &metric,
+        ClusteringContext            &context
+    ){
+    return daviesBouldinIndex(context.rowMajorEntities(entities), centroids, labels, counts, metric, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void daviesBouldinIndices(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &clustersNumbers,
+        const Ref<const MatrixXi>   &labels,
+        const Metric                &metric,
+        Ref<VectorXf>               indices,
+        ClusteringContext           &context
+    ){
+    daviesBouldinIndices(context.rowMajorEntities(entities), centroids, clustersNumbers, labels, metric, indices, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+float silhouetteTest(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const MatrixXfR>  &weights,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+    ){
+    return silhouetteTest(context.rowMajorEntities(entities), clusters, weights, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+float silhouetteTest(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &clusters,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        const SilhouetteOptions     &options,
+        ClusteringContext           &context
+    ){
+    return silhouetteTest(context.rowMajorEntities(entities), clusters, labels, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+int calculateLabels(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        ClusteringContext           &context
+    ){
+    return calculateLabels(context.rowMajorEntities(entities), centroids, labels, metric, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void kmeansGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        const KmeansOptions         &options,
+        ClusteringContext           &context
+    ){
+    kmeansGenerator(context.rowMajorEntities(entities), centroids, labels, counts, metric, generator, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+int clusterGeneratorApproximate(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<MatrixXfR>              weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    return clusterGeneratorApproximate(context.rowMajorEntities(entities), centroids, weights, labels, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+int clusterGeneratorExact(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        MatrixXfR                   &weights,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    return clusterGeneratorExact(context.rowMajorEntities(entities), centroids, weights, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void calculateFuzzyWeights(
+        const MatrixBase<Derived>   &entities,
+        const Ref<const MatrixXf>   &centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        ClusteringContext           &context
+    ){
+    calculateFuzzyWeights(context.rowMajorEntities(entities), centroids, weights, metric, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+void FCMGenerator(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        const Metric                &metric,
+        const FcmOptions            &options,
+        ClusteringContext           &context
+    ){
+    FCMGenerator(context.rowMajorEntities(entities), centroids, weights, metric, options, context);
+}
+
+template<typename Metric, typename Derived, EnableIfColumnMajor<Derived>>
+int clusterGeneratorApproximate(
+        const MatrixBase<Derived>   &entities,
+        Ref<MatrixXf>               centroids,
+        SparseMemberships           &weights,
+        Ref<VectorXi>               labels,
+        const Metric                &metric,
+        const SweepOptions          &options,
+        ClusteringContext           &context
+    ){
+    return clusterGeneratorApproximate(context.rowMajorEntities(entities), centroids, weights, labels, metric, options, context);
+}
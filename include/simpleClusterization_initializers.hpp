@@ -0,0 +1,233 @@
+#pragma once
+///@file simpleClusterization_initializers.hpp
+///@brief Seeding strategies that generate the initial centroids of kmeansGenerator()
+///@details Both strategies keep the distance between every datapoint and its nearest chosen centroid, D(x), and only update it with the centroids
+///         chosen since the last update, so each datapoint is compared with each centroid once. The datapoints are never copied.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_kmeans.hpp>
+
+using namespace Eigen;
+
+/*!
+ * @brief       Lowers the distance between each datapoint and its nearest centroid with the distances from some new centroids
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   newCentroids            The centroids to take into account
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   workspace               The buffers of the distance engine
+ * @param[in-out] nearestDistances      The value of the metric between each datapoint and its nearest centroid
+*/
+template<typename Metric>
+void updateNearestDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &newCentroids,
+        const Metric                &metric,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXf>               nearestDistances
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, newCentroids, workspace, [&](int firstEntity, const auto &tileDistances){
+            auto nearestSegment = nearestDistances.segment(firstEntity, tileDistances.rows());
+            nearestSegment = nearestSegment.cwiseMin(tileDistances.rowwise().minCoeff());
+        });
+    }else{
+        const int entitiesNumber = entities.rows();
+        const int newCentroidsNumber = newCentroids.rows();
+        for(int j=0;j<entitiesNumber;++j){
+            for(int i=0;i<newCentroidsNumber;++i){
+                nearestDistances(j) = std::min(nearestDistances(j), metric(newCentroids.row(i), entities.row(j)));
+            }
+        }
+    }
+}
+
+/*!
+ * @brief       Draws an index with probability proportional to its weight, or uniformly if all weights are 0
+ * @param[in]   weights     The non negative weights of the indices
+ * @param[in]   generator   The random numbers generator
+ * @return      The drawn index
+*/
+inline int drawProportionally(
+        const Ref<const VectorXf>   &weights,
+        std::mt19937                &generator
+    ){
+    const int indicesNumber = weights.size();
+    const double totalWeight = weights.cast<double>().sum();
+    if(!(totalWeight > 0)){
+        return std::uniform_int_distribution<>(0, indicesNumber - 1)(generator);
+    }
+    const double randomWeight = std::uniform_real_distribution<double>(0, totalWeight)(generator);
+    double cumulatedWeight = 0;
+    for(int j=0;j<indicesNumber;++j){
+        cumulatedWeight += weights(j);
+        if(cumulatedWeight > randomWeight){
+            return j;
+        }
+    }
+    //Rounding can leave randomWeight slightly above the last partial sum, so we fall back to the last index with a positive weight
+    int lastIndex = indicesNumber - 1;
+    while(lastIndex > 0 && !(weights(lastIndex) > 0)){
+        --lastIndex;
+    }
+    return lastIndex;
+}
+
+/*!
+ * @brief       Generates initial values for k centroids according to the kmeans++ algorithm
+ * @details     1. Choose one center uniformly at random among the data points.
+ *              2. For each data point x, update D(x), the distance between x and the nearest center that has already been chosen, with the last chosen center.
+ *              3. Choose one new data point at random as a new center, with probability proportional to D(x) (the value of the metric, so squared distances for the euclidean one).
+ *              4. Repeat Steps 2 and 3 until k centers have been chosen.
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[out]  centroids               The centroids of the clusters, the number of rows are the centroids to generate
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   generator               The random numbers generator the seeding is drawn from
+ * @param[in]   workspace               The scratch buffers, on return the first n values of workspace.nearestDistances are D(x) for the first k-1 centroids
+*/
+template<typename Metric>
+void kmeansPlusPlusInitializer(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        Ref<MatrixXf>               centroids,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        KmeansWorkspace             &workspace
+    ){
+    assert(entities.cols()==centroids.cols() && "kmeansPlusPlusInitializer: incompatible matrix sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    auto nearestDistances = storageView<VectorXf>(workspace.nearestDistances, entitiesNumber, 1);
+    nearestDistances.setConstant(std::numeric_limits<float>::infinity());
+    centroids.row(0) = entities.row(std::uniform_int_distribution<>(0, entitiesNumber - 1)(generator));
+    for(int i=1;i<clustersNumber;++i){
+        updateNearestDistances(entities, entitiesSquaredNorms, centroids.middleRows(i - 1, 1), metric, workspace.distances, nearestDistances);
+        centroids.row(i) = entities.row(drawProportionally(nearestDistances, generator));
+    }
+}
+
+/*!
+ * @brief       Runs kmeans++ on a small set of weighted points, where each point counts as many times as its weight
+ * @param[in]   points          The points to choose the centroids from
+ * @param[in]   pointsWeights   The weight of each point
+ * @param[out]  centroids       The chosen centroids
+ * @param[in]   metric          The metric functor you want to use
+ * @param[in]   generator       The random numbers generator the seeding is drawn from
+ * @param[in]   workspace       The scratch buffers
+*/
+template<typename Metric>
+void weightedKmeansPlusPlus(
+        const Ref<const MatrixXf>   &points,
+        const Ref<const VectorXf>   &pointsWeights,
+        Ref<MatrixXf>               centroids,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        KmeansWorkspace             &workspace
+    ){
+    const int pointsNumber = points.rows();
+    const int clustersNumber = centroids.rows();
+    auto nearestDistances = storageView<VectorXf>(workspace.candidatesNearestDistances, pointsNumber, 1);
+    auto drawWeights = storageView<VectorXf>(workspace.drawWeights, pointsNumber, 1);
+    nearestDistances.setConstant(std::numeric_limits<float>::infinity());
+    drawWeights = pointsWeights;
+    centroids.row(0) = points.row(drawProportionally(drawWeights, generator));
+    for(int i=1;i<clustersNumber;++i){
+        for(int j=0;j<pointsNumber;++j){
+            nearestDistances(j) = std::min(nearestDistances(j), metric(centroids.row(i - 1), points.row(j)));
+        }
+        drawWeights = pointsWeights.cwiseProduct(nearestDistances);
+        centroids.row(i) = points.row(drawProportionally(drawWeights, generator));
+    }
+}
+
+/*!
+ * @brief       Generates initial values for k centroids according to the scalable kmeans++ (kmeans||) algorithm, which needs far fewer passes over large datasets
+ * @details     1. Choose one center uniformly at random among the data points.
+ *              2. For a few rounds, sample every data point independently with probability l * D(x) / sum(D), with l = oversamplingFactor * k,
+ *                 and update D(x) with all the centers sampled in the round at once.
+ *              3. Weight every sampled center by the number of data points closer to it than to the other ones.
+ *              4. Reduce the sampled centers to k with weighted kmeans++.
+ *              Falls back to kmeansPlusPlusInitializer() if fewer than k centers were sampled.
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[out]  centroids               The centroids of the clusters, the number of rows are the centroids to generate
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   generator               The random numbers generator the seeding is drawn from
+ * @param[in]   oversamplingFactor      The expected number of centers sampled per round, in multiples of k
+ * @param[in]   rounds                  The number of sampling rounds
+ * @param[in]   workspace               The scratch buffers
+*/
+template<typename Metric>
+void kmeansParallelInitializer(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        Ref<MatrixXf>               centroids,
+        const Metric                &metric,
+        std::mt19937                &generator,
+        float                       oversamplingFactor,
+        int                         rounds,
+        KmeansWorkspace             &workspace
+    ){
+    assert(entities.cols()==centroids.cols() && "kmeansParallelInitializer: incompatible matrix sizes\n");
+    const int statsNumber = entities.cols();
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    const float oversampling = oversamplingFactor * float(clustersNumber);
+    std::uniform_real_distribution<float> floatDistribution(0, 1);
+    std::vector<int> &candidatesIndices = workspace.candidatesIndices;
+    std::vector<int> &roundIndices = workspace.roundIndices;
+    candidatesIndices.assign(1, std::uniform_int_distribution<>(0, entitiesNumber - 1)(generator));
+    auto nearestDistances = storageView<VectorXf>(workspace.nearestDistances, entitiesNumber, 1);
+    nearestDistances.setConstant(std::numeric_limits<float>::infinity());
+    //The first row of the centroids holds the first center until the final seeding overwrites it
+    centroids.row(0) = entities.row(candidatesIndices[0]);
+    updateNearestDistances(entities, entitiesSquaredNorms, centroids.topRows(1), metric, workspace.distances, nearestDistances);
+    for(int round=0;round<rounds;++round){
+        const double totalDistance = nearestDistances.cast<double>().sum();
+        if(!(totalDistance > 0)){
+            break;
+        }
+        const float multiplier = float(oversampling / totalDistance);
+        roundIndices.clear();
+        for(int j=0;j<entitiesNumber;++j){
+            if(floatDistribution(generator) < multiplier * nearestDistances(j)){
+                roundIndices.push_back(j);
+            }
+        }
+        if(roundIndices.empty()){
+            continue;
+        }
+        auto roundCandidates = storageView<MatrixXf>(workspace.candidates, roundIndices.size(), statsNumber);
+        for(int l=0;l<int(roundIndices.size());++l){
+            roundCandidates.row(l) = entities.row(roundIndices[l]);
+        }
+        updateNearestDistances(entities, entitiesSquaredNorms, roundCandidates, metric, workspace.distances, nearestDistances);
+        candidatesIndices.insert(candidatesIndices.end(), roundIndices.begin(), roundIndices.end());
+    }
+    const int candidatesNumber = candidatesIndices.size();
+    if(candidatesNumber < clustersNumber){
+        kmeansPlusPlusInitializer(entities, entitiesSquaredNorms, centroids, metric, generator, workspace);
+        return;
+    }
+    auto candidates = storageView<MatrixXf>(workspace.candidates, candidatesNumber, statsNumber);
+    for(int l=0;l<candidatesNumber;++l){
+        candidates.row(l) = entities.row(candidatesIndices[l]);
+    }
+    auto candidatesWeights = storageView<VectorXf>(workspace.candidatesWeights, candidatesNumber, 1);
+    candidatesWeights.setZero();
+    forEachEntityDistances(entities, entitiesSquaredNorms, candidates, metric, workspace.distances, [&](int, const auto &entityDistances){
+        int nearestCandidate;
+        entityDistances.minCoeff(&nearestCandidate);
+        candidatesWeights(nearestCandidate) += 1.f;
+    });
+    weightedKmeansPlusPlus(candidates, candidatesWeights, centroids, metric, generator, workspace);
+}
@@ -0,0 +1,443 @@
+#pragma once
+///@file simpleClusterization_kmeans.hpp
+///@brief Building blocks of kmeansGenerator(): label-based centroids update and the bounded Hamerly and Elkan algorithms
+///@details Hamerly's and Elkan's algorithms use the triangle inequality to bound the distance between each datapoint and the centroids,
+///         and only evaluate a distance when the bounds can't prove that the closest centroid hasn't changed.
+///         Both take already initialized centroids and follow the same sequence of centroids as the Lloyd loop of kmeansGenerator(),
+///         so they converge to the same clusterization.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <limits>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_stats.hpp>
+
+using namespace Eigen;
+
+///Bounds are compared with this relative margin, so that rounding errors can't make them skip a closer centroid
+const float boundsSlack = 1.f + 1.0E-5f;
+
+/*!
+ * @brief       Sets every centroid to the mean of the datapoints labelled with its index
+ * @param[in]   entities    The datapoints
+ * @param[in]   labels      The index of the cluster of each datapoint
+ * @param[out]  centroids   The centroids of the clusters. The centroid of an empty cluster is set to NaN, like kmeansGenerator() does
+ * @param[out]  counts      The number of datapoints in each cluster
+ * @return      false if some cluster is empty
+*/
+bool updateCentroidsFromLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXi>   &labels,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               counts
+    );
+
+///Scratch buffers of one kmeansGenerator() run. They're only grown (see storageView()), so repeated runs don't allocate once the largest sizes have been seen
+struct KmeansWorkspace{
+    ///The buffers of the distance engine
+    DistanceWorkspace   distances;
+    ///The distance between each datapoint and its nearest centroid, used by the initializers
+    VectorXf            nearestDistances;
+    ///The bound to the distance between each datapoint and its centroid, used by the bounded algorithms
+    VectorXf            upperBounds;
+    ///The bounds to the distance between each datapoint and the other centroids, one per datapoint for Hamerly and one per pair for Elkan
+    VectorXf            lowerBounds;
+    ///The centroids of the previous iteration
+    VectorXf            oldCentroids;
+    ///How much each centroid moved in the last iteration
+    VectorXf            centroidsShifts;
+    ///Half the distance between each centroid and the closest other one
+    VectorXf            halfSeparations;
+    ///The distances between every pair of centroids
+    VectorXf            centroidsDistances;
+    ///The values of the metric between a datapoint and all the centroids, padded to the columns of the centroids panel for the SIMD kernels
+    VectorXf            entityDistances;
+    ///The value of the metric between each datapoint and its centroid at the end of a kmeansGenerator() run
+    VectorXf            assignmentDistances;
+    ///The sums of assignmentDistances over each cluster at the end of a kmeansGenerator() run, which daviesBouldinIndexFromScatter() turns into the index
+    VectorXf            clustersScatter;
+    ///The largest Davies-Bouldin ratio of each cluster
+    VectorXf            clustersRatios;
+    ///The candidate centers sampled by kmeansParallelInitializer(), their indices, weights and copies
+    std::vector<int>    candidatesIndices;
+    std::vector<int>    roundIndices;
+    VectorXf            candidates;
+    VectorXf            candidatesWeights;
+    ///The nearest distances and draw weights of weightedKmeansPlusPlus()
+    VectorXf            candidatesNearestDistances;
+    VectorXf            drawWeights;
+    ///The statistics the runs report to, nullptr if none are attached (see ClusteringContext::setStats())
+    ClusteringStats     *stats              = nullptr;
+
+    /*!
+     * @brief       Grows the buffers to the sizes the runs on entitiesNumber datapoints of statsNumber dimensions with up to clustersNumber clusters need,
+     *              so that which runs the workspace serves first doesn't matter. Only the buffers of the seeding and algorithms the runs can use are grown
+     * @details     The number of candidates kmeansParallelInitializer() samples is random, the buffers that hold them can still grow on a larger draw
+     * @param[in]   candidatesNumber    The number of kmeansParallelInitializer() candidates to make room for, 0 if it isn't used
+     * @param[in]   seeded              Whether the runs choose their initial centroids, which needs the distance of each datapoint to its nearest centroid
+     * @param[in]   lowerBoundsNumber   The number of lower bounds per datapoint the runs keep: 0 if they only use Lloyd, 1 for Hamerly and clustersNumber for Elkan
+    */
+    void reserve(
+            int     entitiesNumber,
+            int     statsNumber,
+            int     clustersNumber,
+            int     candidatesNumber,
+            bool    seeded,
+            int     lowerBoundsNumber
+        ){
+        distances.reserve(entitiesNumber, statsNumber, std::max(clustersNumber, candidatesNumber));
+        storageView<VectorXf>(nearestDistances, seeded ? entitiesNumber : 0, 1);
+        storageView<VectorXf>(upperBounds, lowerBoundsNumber > 0 ? entitiesNumber : 0, 1);
+        //Elkan's bounds are the largest buffer by far, n x k
+        storageView<VectorXf>(lowerBounds, Index(entitiesNumber) * lowerBoundsNumber, 1);
+        storageView<VectorXf>(oldCentroids, clustersNumber * statsNumber, 1);
+        storageView<VectorXf>(centroidsShifts, clustersNumber, 1);
+        storageView<VectorXf>(halfSeparations, clustersNumber, 1);
+        storageView<VectorXf>(centroidsDistances, lowerBoundsNumber > 1 ? clustersNumber * clustersNumber : 0, 1);
+        storageView<VectorXf>(entityDistances, simdPanelColumns(std::max(clustersNumber, candidatesNumber)), 1);
+        storageView<VectorXf>(assignmentDistances, entitiesNumber, 1);
+        storageView<VectorXf>(clustersScatter, clustersNumber, 1);
+        storageView<VectorXf>(clustersRatios, clustersNumber, 1);
+        if(candidatesNumber > 0){
+            candidatesIndices.reserve(candidatesNumber);
+            roundIndices.reserve(candidatesNumber);
+            storageView<VectorXf>(candidates, candidatesNumber * statsNumber, 1);
+            storageView<VectorXf>(candidatesWeights, candidatesNumber, 1);
+            storageView<VectorXf>(candidatesNearestDistances, candidatesNumber, 1);
+            storageView<VectorXf>(drawWeights, candidatesNumber, 1);
+        }
+    }
+};
+
+/*!
+ * @brief       Calls function(j, distances) for every datapoint, where distances(i) is the value of the metric between the j-th datapoint and the i-th centroid
+ * @details     The squared euclidean metric goes through the batched distance engine, the manhattan one through the SIMD kernels
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   workspace               The buffers the distances are computed in
+ * @param[in]   function                A callable with signature void(int j, const RowVectorXf-like &distances)
+*/
+template<typename Metric, typename Function>
+void forEachEntityDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        DistanceWorkspace           &workspace,
+        Function                    &&function
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, workspace, [&](int firstEntity, const auto &tileDistances){
+            for(int j=0;j<tileDistances.rows();++j){
+                function(firstEntity + j, tileDistances.row(j));
+            }
+        });
+    }else if(useSimdPanel<Metric>(entities.cols(), centroids.rows())){
+        blockedPanelDistances(entities, centroids, simdPanelDistances<Metric>(), workspace, [&](int firstEntity, const auto &tileDistances){
+            for(int j=0;j<tileDistances.rows();++j){
+                function(firstEntity + j, tileDistances.row(j));
+            }
+        });
+    }else{
+        const int entitiesNumber = entities.rows();
+        const int clustersNumber = centroids.rows();
+        auto distances = storageView<RowVectorXf>(workspace.tile, 1, clustersNumber);
+        for(int j=0;j<entitiesNumber;++j){
+            for(int i=0;i<clustersNumber;++i){
+                distances(i) = metric(centroids.row(i), entities.row(j));
+            }
+            function(j, distances);
+        }
+    }
+}
+
+/*!
+ * @brief       Same as forEachEntityDistances() above, with the squared norms and buffers allocated for the call
+*/
+template<typename Metric, typename Function>
+void forEachEntityDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        Function                    &&function
+    ){
+    VectorXf entitiesSquaredNorms;
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        entitiesSquaredNorms = entities.rowwise().squaredNorm();
+    }
+    DistanceWorkspace workspace;
+    forEachEntityDistances(entities, entitiesSquaredNorms, centroids, metric, workspace, function);
+}
+
+/*!
+ * @brief       Computes the distance between each centroid and the closest other one, and optionally the full matrix of distances between centroids
+ * @param[in]   centroids           The centroids of the clusters
+ * @param[in]   metric              The metric functor you want to use
+ * @param[out]  halfSeparations     Half the distance between each centroid and the closest other one
+ * @param[out]  centroidsDistances  If not null, filled with the distances between every pair of centroids
+*/
+template<typename Metric>
+void centroidsSeparations(
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        Ref<VectorXf>               halfSeparations,
+        Ref<MatrixXf>               *centroidsDistances
+    ){
+    const int clustersNumber = centroids.rows();
+    halfSeparations.setConstant(std::numeric_limits<float>::infinity());
+    for(int i=0;i<clustersNumber;++i){
+        for(int l=i+1;l<clustersNumber;++l){
+            const float distance = MetricTraits<Metric>::metricDistance(metric(centroids.row(i), centroids.row(l)));
+            halfSeparations(i) = std::min(halfSeparations(i), distance);
+            halfSeparations(l) = std::min(halfSeparations(l), distance);
+            if(centroidsDistances){
+                (*centroidsDistances)(i, l) = distance;
+                (*centroidsDistances)(l, i) = distance;
+            }
+        }
+    }
+    halfSeparations *= 0.5f;
+}
+
+/*!
+ * @brief       Runs kmeans from the given centroids with Hamerly's algorithm, suited for a low number of clusters
+ * @param[in]   entities    The datapoints
+ * @param[in-out] centroids The initial centroids, and the final ones on return
+ * @param[out]  labels      The index of the cluster of each datapoint
+ * @param[out]  counts      The number of datapoints in each cluster
+ * @param[in]   metric      The metric functor you want to use, it must satisfy the triangle inequality
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   workspace   The scratch buffers of the run
+ * @return      false if a cluster got empty, in which case the run is interrupted and the caller should resume with the Lloyd loop from labels
+*/
+template<typename Metric>
+bool hamerlyKmeans(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        KmeansWorkspace             &workspace
+    ){
+    static_assert(MetricTraits<Metric>::satisfiesTriangleInequality, "hamerlyKmeans: the metric doesn't satisfy the triangle inequality\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    auto metricDistance = [&](const auto &v1, const auto &v2){
+        return MetricTraits<Metric>::metricDistance(metric(v1, v2));
+    };
+    //upperBounds(j) bounds the distance from the assigned centroid from above, lowerBounds(j) the distance from any other centroid from below
+    auto upperBounds        = storageView<VectorXf>(workspace.upperBounds, entitiesNumber, 1);
+    auto lowerBounds        = storageView<VectorXf>(workspace.lowerBounds, entitiesNumber, 1);
+    auto centroidsShifts    = storageView<VectorXf>(workspace.centroidsShifts, clustersNumber, 1);
+    auto halfSeparations    = storageView<VectorXf>(workspace.halfSeparations, clustersNumber, 1);
+    auto oldCentroids       = storageView<MatrixXf>(workspace.oldCentroids, clustersNumber, centroids.cols());
+    auto paddedDistances    = storageView<RowVectorXf>(workspace.entityDistances, 1, simdPanelColumns(clustersNumber));
+    auto distances          = paddedDistances.head(clustersNumber);
+    //The datapoints whose bounds fail are compared to all the centroids at once by the SIMD kernels, from a panel rebuilt at every iteration
+    const bool simdPanel = useSimdPanel<Metric>(entities.cols(), clustersNumber);
+    panelDistances_t *panelDistances = simdPanel ? simdPanelDistances<Metric>() : nullptr;
+    //Assigns the j-th datapoint from the values of the metric to all centroids, ties go to the lowest index like in calculateLabels()
+    auto assignEntity = [&](int j, const auto &entityDistances){
+        int minIndex = 0;
+        float minDistance = entityDistances(0);
+        float secondDistance = std::numeric_limits<float>::infinity();
+        for(int i=1;i<clustersNumber;++i){
+            if(entityDistances(i) < minDistance){
+                secondDistance = minDistance;
+                minDistance = entityDistances(i);
+                minIndex = i;
+            }else{
+                secondDistance = std::min(secondDistance, entityDistances(i));
+            }
+        }
+        labels(j) = minIndex;
+        upperBounds(j) = MetricTraits<Metric>::metricDistance(minDistance);
+        lowerBounds(j) = MetricTraits<Metric>::metricDistance(secondDistance);
+    };
+    PhaseTimer initialAssignmentTimer(workspace.stats, ClusteringPhase::Assignment);
+    forEachEntityDistances(entities, entitiesSquaredNorms, centroids, metric, workspace.distances, assignEntity);
+    initialAssignmentTimer.stop();
+    //The metric evaluations of the current iteration, the first one includes the initial assignment
+    long long distanceEvaluations = (long long)entitiesNumber * clustersNumber;
+    for(int iteration=0;;++iteration){
+        PhaseTimer updateTimer(workspace.stats, ClusteringPhase::Update);
+        oldCentroids = centroids;
+        if(!updateCentroidsFromLabels(entities, labels, centroids, counts)){
+            if(workspace.stats){
+                workspace.stats->addDistanceEvaluations(distanceEvaluations);
+                workspace.stats->recordEmptyCluster();
+            }
+            return false;
+        }
+        int maxShiftIndex = 0;
+        float maxShift = 0;
+        float secondMaxShift = 0;
+        for(int i=0;i<clustersNumber;++i){
+            centroidsShifts(i) = metricDistance(oldCentroids.row(i), centroids.row(i));
+            if(centroidsShifts(i) > maxShift){
+                secondMaxShift = maxShift;
+                maxShift = centroidsShifts(i);
+                maxShiftIndex = i;
+            }else{
+                secondMaxShift = std::max(secondMaxShift, centroidsShifts(i));
+            }
+        }
+        centroidsSeparations(centroids, metric, halfSeparations, nullptr);
+        distanceEvaluations += clustersNumber + (long long)clustersNumber * (clustersNumber - 1) / 2;
+        updateTimer.stop();
+        PhaseTimer assignmentTimer(workspace.stats, ClusteringPhase::Assignment);
+        const float *panel = simdPanel ? centroidsPanel(centroids, workspace.distances.centroidsPanel).data() : nullptr;
+        int changedLabels = 0;
+        for(int j=0;j<entitiesNumber;++j){
+            const int label = labels(j);
+            upperBounds(j) += centroidsShifts(label);
+            lowerBounds(j) -= label==maxShiftIndex ? secondMaxShift : maxShift;
+            const float bound = std::max(halfSeparations(label), lowerBounds(j));
+            if(upperBounds(j) * boundsSlack < bound){
+                continue;
+            }
+            upperBounds(j) = metricDistance(entities.row(j), centroids.row(label));
+            ++distanceEvaluations;
+            if(upperBounds(j) * boundsSlack < bound){
+                continue;
+            }
+            distanceEvaluations += clustersNumber;
+            if(simdPanel){
+                panelDistances(entities.row(j).data(), 1, entities.outerStride(), panel, entities.cols(), paddedDistances.size(), paddedDistances.data(), paddedDistances.size());
+            }else{
+                for(int i=0;i<clustersNumber;++i){
+                    distances(i) = metric(centroids.row(i), entities.row(j));
+                }
+            }
+            assignEntity(j, distances);
+            changedLabels += labels(j)!=label;
+        }
+        assignmentTimer.stop();
+        if(workspace.stats){
+            workspace.stats->recordIteration({ClusteringAlgorithm::Hamerly, clustersNumber, iteration, changedLabels, maxShift}, distanceEvaluations);
+        }
+        distanceEvaluations = 0;
+        if(changedLabels==0){
+            return true;
+        }
+    }
+}
+
+/*!
+ * @brief       Runs kmeans from the given centroids with Elkan's algorithm, suited for a high number of clusters
+ * @note        It keeps a bound for every pair of datapoint and centroid, so it needs O(n*k) memory
+ * @param[in]   entities    The datapoints
+ * @param[in-out] centroids The initial centroids, and the final ones on return
+ * @param[out]  labels      The index of the cluster of each datapoint
+ * @param[out]  counts      The number of datapoints in each cluster
+ * @param[in]   metric      The metric functor you want to use, it must satisfy the triangle inequality
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   workspace   The scratch buffers of the run
+ * @return      false if a cluster got empty, in which case the run is interrupted and the caller should resume with the Lloyd loop from labels
+*/
+template<typename Metric>
+bool elkanKmeans(
+        const Ref<const MatrixXfR>  &entities,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               labels,
+        Ref<VectorXi>               counts,
+        const Metric                &metric,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        KmeansWorkspace             &workspace
+    ){
+    static_assert(MetricTraits<Metric>::satisfiesTriangleInequality, "elkanKmeans: the metric doesn't satisfy the triangle inequality\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    auto metricDistance = [&](const auto &v1, const auto &v2){
+        return MetricTraits<Metric>::metricDistance(metric(v1, v2));
+    };
+    //upperBounds(j) bounds the distance from the assigned centroid from above, lowerBounds(j, i) the distance from the i-th centroid from below
+    auto upperBounds        = storageView<VectorXf>(workspace.upperBounds, entitiesNumber, 1);
+    auto lowerBounds        = storageView<MatrixXfR>(workspace.lowerBounds, entitiesNumber, clustersNumber);
+    auto centroidsShifts    = storageView<RowVectorXf>(workspace.centroidsShifts, 1, clustersNumber);
+    auto halfSeparations    = storageView<VectorXf>(workspace.halfSeparations, clustersNumber, 1);
+    auto oldCentroids       = storageView<MatrixXf>(workspace.oldCentroids, clustersNumber, centroids.cols());
+    Ref<MatrixXf> centroidsDistances = storageView<MatrixXf>(workspace.centroidsDistances, clustersNumber, clustersNumber);
+    centroidsDistances.setZero();
+    PhaseTimer initialAssignmentTimer(workspace.stats, ClusteringPhase::Assignment);
+    forEachEntityDistances(entities, entitiesSquaredNorms, centroids, metric, workspace.distances, [&](int j, const auto &entityDistances){
+        int minIndex;
+        entityDistances.minCoeff(&minIndex);
+        labels(j) = minIndex;
+        for(int i=0;i<clustersNumber;++i){
+            lowerBounds(j, i) = MetricTraits<Metric>::metricDistance(entityDistances(i));
+        }
+        upperBounds(j) = lowerBounds(j, minIndex);
+    });
+    initialAssignmentTimer.stop();
+    //The metric evaluations of the current iteration, the first one includes the initial assignment
+    long long distanceEvaluations = (long long)entitiesNumber * clustersNumber;
+    for(int iteration=0;;++iteration){
+        PhaseTimer updateTimer(workspace.stats, ClusteringPhase::Update);
+        oldCentroids = centroids;
+        if(!updateCentroidsFromLabels(entities, labels, centroids, counts)){
+            if(workspace.stats){
+                workspace.stats->addDistanceEvaluations(distanceEvaluations);
+                workspace.stats->recordEmptyCluster();
+            }
+            return false;
+        }
+        for(int i=0;i<clustersNumber;++i){
+            centroidsShifts(i) = metricDistance(oldCentroids.row(i), centroids.row(i));
+        }
+        centroidsSeparations(centroids, metric, halfSeparations, &centroidsDistances);
+        distanceEvaluations += clustersNumber + (long long)clustersNumber * (clustersNumber - 1) / 2;
+        updateTimer.stop();
+        PhaseTimer assignmentTimer(workspace.stats, ClusteringPhase::Assignment);
+        int changedLabels = 0;
+        for(int j=0;j<entitiesNumber;++j){
+            const int oldLabel = labels(j);
+            lowerBounds.row(j) = (lowerBounds.row(j) - centroidsShifts).cwiseMax(0.f);
+            int label = oldLabel;
+            float upperBound = upperBounds(j) + centroidsShifts(label);
+            if(upperBound * boundsSlack < halfSeparations(label)){
+                upperBounds(j) = upperBound;
+                continue;
+            }
+            bool tightUpperBound = false;
+            for(int i=0;i<clustersNumber;++i){
+                if(i==label || upperBound * boundsSlack < lowerBounds(j, i) || upperBound * boundsSlack < 0.5f * centroidsDistances(label, i)){
+                    continue;
+                }
+                if(!tightUpperBound){
+                    upperBound = metricDistance(entities.row(j), centroids.row(label));
+                    ++distanceEvaluations;
+                    lowerBounds(j, label) = upperBound;
+                    tightUpperBound = true;
+                    if(upperBound * boundsSlack < lowerBounds(j, i) || upperBound * boundsSlack < 0.5f * centroidsDistances(label, i)){
+                        continue;
+                    }
+                }
+                const float distance = metricDistance(entities.row(j), centroids.row(i));
+                ++distanceEvaluations;
+                lowerBounds(j, i) = distance;
+                //Ties go to the lowest index like in calculateLabels()
+                if(distance < upperBound || (distance==upperBound && i < label)){
+                    label = i;
+                    upperBound = distance;
+                }
+            }
+            upperBounds(j) = upperBound;
+            labels(j) = label;
+            changedLabels += label!=oldLabel;
+        }
+        assignmentTimer.stop();
+        if(workspace.stats){
+            workspace.stats->recordIteration({ClusteringAlgorithm::Elkan, clustersNumber, iteration, changedLabels, centroidsShifts.maxCoeff()}, distanceEvaluations);
+        }
+        distanceEvaluations = 0;
+        if(changedLabels==0){
+            return true;
+        }
+    }
+}
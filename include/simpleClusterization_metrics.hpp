@@ -0,0 +1,153 @@
+#pragma once
+///@file simpleClusterization_metrics.hpp
+///@brief Compile-time metric functors that can be passed to the templated overloads of the library's functions
+///@details A metric is any copyable type with a const call operator accepting two Eigen row expressions and returning a float.
+///         Unlike squaredNorm_t, the arguments are taken as expressions, so rows of the datapoints and centroids matrices are never copied into temporaries,
+///         and the call can be inlined and vectorized by the compiler.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <simpleClusterization_common.hpp>
+
+using namespace Eigen;
+
+///The squared euclidean distance, equivalent to euclideanNorm() but without the temporaries
+struct SquaredEuclideanMetric{
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        return (v1 - v2).squaredNorm();
+    }
+};
+
+///The manhattan (L1) distance
+struct ManhattanMetric{
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        return (v1 - v2).template lpNorm<1>();
+    }
+};
+
+///The cosine distance, 1 - cos(v1, v2). Zero vectors are deemed orthogonal to everything
+struct CosineMetric{
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        const float normsProduct = std::sqrt(v1.squaredNorm() * v2.squaredNorm());
+        if(normsProduct <= 0.f){
+            return 1.f;
+        }
+        return 1.f - v1.dot(v2) / normsProduct;
+    }
+};
+
+/*!
+ * @brief   The squared Mahalanobis distance (v1 - v2) * S^-1 * (v1 - v2)^T, where S is the covariance matrix of the data
+ * @details The upper Cholesky factor U of S^-1 is stored, so that the distance is the squared norm of U * (v1 - v2)^T.
+ *          It's evaluated coefficient by coefficient, as the product would otherwise need a temporary.
+*/
+struct MahalanobisMetric{
+    ///The upper Cholesky factor of the inverse covariance matrix
+    MatrixXfR choleskyFactor;
+
+    ///@param[in]   inverseCovariance   The inverse of the covariance matrix of the data, it must be symmetric positive definite
+    explicit MahalanobisMetric(const Ref<const MatrixXf> &inverseCovariance){
+        assert(inverseCovariance.rows()==inverseCovariance.cols() && "MahalanobisMetric: the inverse covariance matrix must be square\n");
+        choleskyFactor = inverseCovariance.llt().matrixU();
+    }
+
+    /*!
+     * @brief       Builds the metric from the covariance of the datapoints themselves
+     * @param[in]   entities    The datapoints
+     * @return      The Mahalanobis metric of the dataset
+    */
+    static MahalanobisMetric fromEntities(const Ref<const MatrixXfR> &entities){
+        const MatrixXf centered = entities.rowwise() - entities.colwise().mean();
+        const MatrixXf covariance = (centered.transpose() * centered) / float(std::max<Index>(entities.rows() - 1, 1));
+        return MahalanobisMetric(covariance.inverse());
+    }
+
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        const Index statsNumber = choleskyFactor.rows();
+        float distance = 0;
+        for(Index i=0;i<statsNumber;++i){
+            float projection = 0;
+            for(Index j=i;j<statsNumber;++j){
+                projection += choleskyFactor(i, j) * (v1.coeff(j) - v2.coeff(j));
+            }
+            distance += projection * projection;
+        }
+        return distance;
+    }
+};
+
+/*!
+ * @brief   Compile-time properties of a metric, used to pick specialized code paths.
+ * @details The defaults are the conservative ones, specialize this template to opt a custom metric into the faster paths.
+*/
+template<typename Metric>
+struct MetricTraits{
+    ///Whether the metric is the squared euclidean distance, which enables the batched distance engine of simpleClusterization_distances.hpp
+    static constexpr bool isSquaredEuclidean = false;
+    ///Whether metricDistance() of the metric's values satisfies the triangle inequality, which enables the bounded kmeans algorithms
+    static constexpr bool satisfiesTriangleInequality = false;
+    ///Maps a value returned by the metric to a proper distance, e.g. takes the square root of squared distances
+    static float metricDistance(float value){
+        return value;
+    }
+};
+
+template<>
+struct MetricTraits<SquaredEuclideanMetric>{
+    static constexpr bool isSquaredEuclidean = true;
+    static constexpr bool satisfiesTriangleInequality = true;
+    static float metricDistance(float value){
+        return std::sqrt(value);
+    }
+};
+
+template<>
+struct MetricTraits<ManhattanMetric>{
+    static constexpr bool isSquaredEuclidean = false;
+    static constexpr bool satisfiesTriangleInequality = true;
+    static float metricDistance(float value){
+        return value;
+    }
+};
+
+template<>
+struct MetricTraits<MahalanobisMetric>{
+    static constexpr bool isSquaredEuclidean = false;
+    static constexpr bool satisfiesTriangleInequality = true;
+    static float metricDistance(float value){
+        return std::sqrt(value);
+    }
+};
+
+///Wraps a squaredNorm_t pointer so that it can be used where a metric functor is expected. Every call copies its arguments into VectorXf temporaries
+struct FunctionPointerMetric{
+    squaredNorm_t *norm;
+
+    explicit FunctionPointerMetric(squaredNorm_t *norm) : norm(norm){}
+
+    template<typename Derived1, typename Derived2>
+    float operator()(
+            const MatrixBase<Derived1>  &v1,
+            const MatrixBase<Derived2>  &v2
+        ) const{
+        return (*norm)(v1, v2);
+    }
+};
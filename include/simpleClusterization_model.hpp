@@ -0,0 +1,294 @@
+#pragma once
+///@file simpleClusterization_model.hpp
+///@brief A fitted clusterization kept to serve requests: assigning new datapoints to its centroids, and folding new datapoints into it
+///@details A ClusteringModel holds the centroids, the number of datapoints each of them has received, and what the distance engines derive from
+///         the centroids (their squared norms and the panel of the SIMD kernels), computed once whenever the centroids change rather than at every call.
+///         The const methods only read the model, so any number of threads can call them on the same model at the same time, each with its own context.
+///         partialFit() and load() modify the model and must not run concurrently with anything else on it: a server would rather update a copy
+///         and publish it, e.g. through a std::shared_ptr<const ClusteringModel>.
+///         A model file is a 64 bytes header followed by the k x d centroids in row-major 32 bits floats and the k counts in 64 bits floats,
+///         in the machine's byte order like the dataset files of simpleClusterization_dataset.hpp.
+
+#include <Eigen/Dense>
+#include <cassert>
+#include <string>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_context.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_stats.hpp>
+#include <simpleClusterization_streaming.hpp>
+
+using namespace Eigen;
+
+///The version of the format written by ClusteringModel::save()
+const std::uint32_t modelFormatVersion = 1;
+
+/*!
+ * @brief   Centroids ready to label new datapoints, and to be updated from them
+ * @note    The scratch memory of the calls comes from the context they're given, so once a context has served a call,
+ *          the following calls on batches of the same or smaller sizes don't allocate any memory
+*/
+class ClusteringModel{
+public:
+    ClusteringModel() = default;
+
+    /*!
+     * @brief       Creates a model from the result of a clusterization
+     * @param[in]   centroids   The centroids of the clusters
+     * @param[in]   counts      The number of datapoints of each cluster, they weigh the centroids against the datapoints partialFit() adds
+    */
+    ClusteringModel(
+            const Ref<const MatrixXf>   &centroids,
+            const Ref<const VectorXi>   &counts
+        ){
+        setCentroids(centroids, counts);
+    }
+
+    ///Replaces the centroids and counts of the model, see the constructor
+    void setCentroids(
+            const Ref<const MatrixXf>   &centroids,
+            const Ref<const VectorXi>   &counts
+        );
+
+    int clustersNumber() const{
+        return modelCentroids.rows();
+    }
+    int statsNumber() const{
+        return modelCentroids.cols();
+    }
+    ///@return The centroids of the clusters
+    const MatrixXf &centroids() const{
+        return modelCentroids;
+    }
+    ///@return The number of datapoints each cluster has received, those of the clusterization included
+    const VectorXd &counts() const{
+        return modelCounts;
+    }
+
+    /*!
+     * @brief       Assigns each datapoint to its closest centroid, as calculateLabels() does
+     * @param[in]   entities    The datapoints
+     * @param[out]  labels      The index of the closest centroid to each datapoint
+     * @param[out]  distances   The value of the metric between each datapoint and its closest centroid
+     * @param[in]   metric      The metric the model was fitted with
+     * @param[in]   context     The scratch buffers of the calling thread, see simpleClusterization_context.hpp
+    */
+    template<typename Metric>
+    void predict(
+            const Ref<const MatrixXfR>  &entities,
+            Ref<VectorXi>               labels,
+            Ref<VectorXf>               distances,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        assert(distances.size()==entities.rows() && "ClusteringModel::predict: incompatible matrix sizes\n");
+        assign(entities, labels, &distances, metric, context);
+    }
+
+    ///Same as predict() above, without the distances
+    template<typename Metric>
+    void predict(
+            const Ref<const MatrixXfR>  &entities,
+            Ref<VectorXi>               labels,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        assign(entities, labels, nullptr, metric, context);
+    }
+
+    /*!
+     * @brief       Computes the fuzzy memberships of the datapoints: the weights of calculateFuzzyWeights(), normalized so that those of each datapoint sum up to 1
+     * @param[in]   entities    The datapoints
+     * @param[out]  weights     The k x n memberships
+     * @param[in]   metric      The metric the model was fitted with
+     * @param[in]   context     The scratch buffers of the calling thread
+    */
+    template<typename Metric>
+    void predictFuzzy(
+            const Ref<const MatrixXfR>  &entities,
+            Ref<MatrixXfR>              weights,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        assert(entities.cols()==statsNumber() && weights.rows()==clustersNumber() && weights.cols()==entities.rows() && "ClusteringModel::predictFuzzy: incompatible matrix sizes\n");
+        const int entitiesNumber = entities.rows();
+        const int clustersNumber = modelCentroids.rows();
+        ClusteringStats *stats = context.stats();
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        if(stats){
+            stats->addDistanceEvaluations((long long)entitiesNumber * clustersNumber);
+        }
+        //The memberships of a tile are normalized while it's still in cache
+        auto membershipsTile = [&](int firstEntity, const auto &tileDistances){
+            assert((tileDistances.array() > FCM_THRESHOLD).all() && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+            auto tileWeights = weights.middleCols(firstEntity, tileDistances.rows());
+            tileWeights = tileDistances.transpose().cwiseInverse();
+            tileWeights.array().rowwise() /= tileWeights.colwise().sum().array();
+        };
+        DistanceWorkspace &workspace = context.sweepWorkspaces[0].kmeans.distances;
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            auto entitiesSquaredNorms = storageView<VectorXf>(context.entitiesSquaredNorms, entitiesNumber, 1);
+            entitiesSquaredNorms = entities.rowwise().squaredNorm();
+            squaredEuclideanFuzzyWeights(entities, entitiesSquaredNorms, modelCentroids, centroidsSquaredNorms, workspace, weights);
+            weights.array().rowwise() /= weights.colwise().sum().array();
+            return;
+        }
+        if(useSimdPanel<Metric>(statsNumber(), clustersNumber)){
+            blockedPanelDistances(entities, panel(), clustersNumber, simdPanelDistances<Metric>(), workspace, membershipsTile);
+            return;
+        }
+        for(int j=0;j<entitiesNumber;++j){
+            for(int i=0;i<clustersNumber;++i){
+                weights(i, j) = metric(modelCentroids.row(i), entities.row(j));
+                assert(weights(i, j) > FCM_THRESHOLD && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+            }
+        }
+        weights.array() = 1.0 / weights.array();
+        weights.array().rowwise() /= weights.colwise().sum().array();
+    }
+
+    /*!
+     * @brief       Folds a batch of new datapoints into the model with a mini-batch k-means step, see simpleClusterization_streaming.hpp:
+     *              each centroid becomes the mean of all the datapoints it has received, the counts of the clusterization included
+     * @param[in]   entities    The new datapoints
+     * @param[in]   metric      The metric the model was fitted with, used to assign the datapoints
+     * @param[in]   context     The scratch buffers
+    */
+    template<typename Metric>
+    void partialFit(
+            const Ref<const MatrixXfR>  &entities,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ){
+        StreamingWorkspace &workspace = context.streaming;
+        auto labels = storageView<VectorXi>(workspace.chunkLabels, entities.rows(), 1);
+        assign(entities, labels, nullptr, metric, context);
+        PhaseTimer updateTimer(context.stats(), ClusteringPhase::Update);
+        auto centroidsSums = storageView<MatrixXf>(workspace.centroidsSums, clustersNumber(), statsNumber());
+        auto chunkCounts = storageView<VectorXi>(workspace.chunkCounts, clustersNumber(), 1);
+        miniBatchUpdate(entities, labels, modelCentroids, modelCounts, centroidsSums, chunkCounts);
+        prepare();
+    }
+
+    ///@name Column-major overloads
+    ///@brief Same as the functions above for column-major datapoints, converted once per call into a buffer of the context, see ClusteringContext::rowMajorEntities()
+    ///@{
+    template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+    void predict(
+            const MatrixBase<Derived>   &entities,
+            Ref<VectorXi>               labels,
+            Ref<VectorXf>               distances,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        predict(context.rowMajorEntities(entities), labels, distances, metric, context);
+    }
+
+    template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+    void predict(
+            const MatrixBase<Derived>   &entities,
+            Ref<VectorXi>               labels,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        predict(context.rowMajorEntities(entities), labels, metric, context);
+    }
+
+    template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+    void predictFuzzy(
+            const MatrixBase<Derived>   &entities,
+            Ref<MatrixXfR>              weights,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        predictFuzzy(context.rowMajorEntities(entities), weights, metric, context);
+    }
+
+    template<typename Metric, typename Derived, EnableIfColumnMajor<Derived> = 0>
+    void partialFit(
+            const MatrixBase<Derived>   &entities,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ){
+        partialFit(context.rowMajorEntities(entities), metric, context);
+    }
+    ///@}
+
+    /*!
+     * @brief       Writes the model to a file
+     * @param[in]   path    The path of the file, overwritten if it exists
+     * @return      false if the file can't be written
+    */
+    bool save(
+            const std::string &path
+        ) const;
+
+    /*!
+     * @brief       Reads a model written by save(), replacing this one
+     * @param[in]   path    The path of the file
+     * @return      false if the file can't be read or isn't a valid model file, in which case the model is left unchanged
+    */
+    bool load(
+            const std::string &path
+        );
+
+private:
+    MatrixXf        modelCentroids;
+    VectorXd        modelCounts;
+    ///The squared norms of the centroids, for the matrix product engine
+    RowVectorXf     centroidsSquaredNorms;
+    ///The centroids laid out for the SIMD kernels, see centroidsPanel()
+    VectorXf        panelStorage;
+
+    ///Computes the data derived from the centroids, after they changed
+    void prepare();
+
+    Map<const MatrixXfR> panel() const{
+        return Map<const MatrixXfR>(panelStorage.data(), statsNumber(), simdPanelColumns(clustersNumber()));
+    }
+
+    ///Same as assignLabels(), on the data prepared from the centroids
+    template<typename Metric>
+    void assign(
+            const Ref<const MatrixXfR>  &entities,
+            Ref<VectorXi>               labels,
+            Ref<VectorXf>               *distances,
+            const Metric                &metric,
+            ClusteringContext           &context
+        ) const{
+        assert(clustersNumber() > 0 && entities.cols()==statsNumber() && labels.size()==entities.rows() && "ClusteringModel::predict: incompatible matrix sizes\n");
+        const int entitiesNumber = entities.rows();
+        const int clustersNumber = modelCentroids.rows();
+        ClusteringStats *stats = context.stats();
+        PhaseTimer assignmentTimer(stats, ClusteringPhase::Assignment);
+        if(stats){
+            stats->addDistanceEvaluations((long long)entitiesNumber * clustersNumber);
+        }
+        DistanceWorkspace &workspace = context.sweepWorkspaces[0].kmeans.distances;
+        if(useSimdPanel<Metric>(statsNumber(), clustersNumber)){
+            preparedPanelLabels(entities, panel(), simdPanelArgmin<Metric>(), workspace, labels, distances);
+            return;
+        }
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            auto entitiesSquaredNorms = storageView<VectorXf>(context.entitiesSquaredNorms, entitiesNumber, 1);
+            entitiesSquaredNorms = entities.rowwise().squaredNorm();
+            preparedSquaredEuclideanLabels(entities, entitiesSquaredNorms, modelCentroids, centroidsSquaredNorms, workspace, labels, distances);
+            return;
+        }
+        for(int j=0;j<entitiesNumber;++j){
+            float minDistance = metric(modelCentroids.row(0), entities.row(j));
+            int minIndex = 0;
+            for(int i=1;i<clustersNumber;++i){
+                const float currentDistance = metric(modelCentroids.row(i), entities.row(j));
+                if(currentDistance < minDistance){
+                    minDistance = currentDistance;
+                    minIndex = i;
+                }
+            }
+            labels(j) = minIndex;
+            if(distances){
+                (*distances)(j) = minDistance;
+            }
+        }
+    }
+};
@@ -0,0 +1,191 @@
+#pragma once
+///@file simpleClusterization_silhouette.hpp
+///@brief Kernels computing the silhouette of every datapoint of a hard clusterization, used by silhouetteTest()
+///@details The silhouette of a datapoint x in cluster A is s(x) = (b(x) - a(x)) / max(a(x), b(x)), where a(x) is the mean distance between x and
+///         the other datapoints of A and b(x) is the lowest mean distance between x and the datapoints of another cluster.
+///         Datapoints alone in their cluster have a silhouette of 0. Distances are the metric values mapped through MetricTraits::metricDistance,
+///         so the squared euclidean metric yields the usual euclidean silhouette.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_metrics.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_threadPool.hpp>
+#include <simpleClusterization_kmeans.hpp>
+
+using namespace Eigen;
+
+///The number of datapoints whose silhouette is computed by a single job of exactSilhouettes()
+const int silhouetteBlockSize = 256;
+
+///Scratch buffers of silhouetteTest(). They're only grown (see storageView()), so repeated calls don't allocate once the largest sizes have been seen
+struct SilhouetteWorkspace{
+    ///The buffers of the distance engine, one per worker of the thread pool
+    std::vector<DistanceWorkspace>  workersDistances;
+    ///The distances between a block of datapoints and each cluster, one per worker of the thread pool
+    std::vector<VectorXf>           workersClustersDistances;
+    ///The squared norms of the datapoints the silhouette is computed on
+    VectorXf                        entitiesSquaredNorms;
+    ///The silhouette of each datapoint, and its weight in the average
+    VectorXf                        silhouettes;
+    VectorXf                        averageWeights;
+    ///The cluster of each datapoint, and the number of datapoints in each cluster
+    VectorXi                        labels;
+    VectorXi                        counts;
+    ///How much each datapoint is more attached to its cluster than to the runner-up, for fuzzy clusterizations
+    VectorXf                        weightsGaps;
+    ///The sampled datapoints, row-major like the datapoints they're copied from, their indices and their clusters
+    std::vector<int>                sampleIndices;
+    VectorXf                        sampleEntities;
+    VectorXi                        sampleLabels;
+};
+
+/*!
+ * @brief       Computes the silhouette of a datapoint from its distances to the clusters
+ * @param[in]   clustersDistances   The sum of the distances between the datapoint and the datapoints of each cluster, itself excluded
+ * @param[in]   counts              The number of datapoints in each cluster
+ * @param[in]   label               The cluster of the datapoint
+ * @return      The silhouette of the datapoint
+*/
+template<typename Derived>
+float silhouetteFromClustersDistances(
+        const MatrixBase<Derived>   &clustersDistances,
+        const Ref<const VectorXi>   &counts,
+        int                         label
+    ){
+    if(counts(label)<=1){
+        return 0.;
+    }
+    const float ownDistance = clustersDistances(label) / float(counts(label) - 1);
+    float otherDistance = std::numeric_limits<float>::infinity();
+    for(int i=0;i<counts.size();++i){
+        if(i!=label && counts(i)>0){
+            otherDistance = std::min(otherDistance, clustersDistances(i) / float(counts(i)));
+        }
+    }
+    const float maxDistance = std::max(ownDistance, otherDistance);
+    if(!(maxDistance > 0) || otherDistance==std::numeric_limits<float>::infinity()){
+        return 0.;
+    }
+    return (otherDistance - ownDistance) / maxDistance;
+}
+
+/*!
+ * @brief       Computes the exact silhouette of every datapoint, O(n^2) distances
+ * @details     The datapoints are split in blocks of silhouetteBlockSize that are spread over the thread pool. Each job accumulates the distances
+ *              between its block and all the datapoints into a k x block matrix, through the batched distance engine for the squared euclidean metric
+ *              and the SIMD kernels for the manhattan one
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   labels                  The index of the cluster of each datapoint
+ * @param[in]   counts                  The number of datapoints in each cluster
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   threadPool              The pool the blocks are spread over
+ * @param[in]   workspace               The scratch buffers of the workers
+ * @param[out]  silhouettes             The silhouette of each datapoint
+*/
+template<typename Metric>
+void exactSilhouettes(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const VectorXi>   &labels,
+        const Ref<const VectorXi>   &counts,
+        const Metric                &metric,
+        ThreadPool                  &threadPool,
+        SilhouetteWorkspace         &workspace,
+        Ref<VectorXf>               silhouettes
+    ){
+    assert(labels.size()==entities.rows() && silhouettes.size()==entities.rows() && "exactSilhouettes: incompatible sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = counts.size();
+    if(int(workspace.workersDistances.size()) < threadPool.size()){
+        workspace.workersDistances.resize(threadPool.size());
+        workspace.workersClustersDistances.resize(threadPool.size());
+    }
+    //Every worker is ready for a whole block, as which blocks it gets depends on the scheduling
+    for(int workerIndex=0;workerIndex<threadPool.size();++workerIndex){
+        workspace.workersDistances[workerIndex].reserve(entitiesNumber, entities.cols(), std::min(silhouetteBlockSize, entitiesNumber));
+        storageView<MatrixXf>(workspace.workersClustersDistances[workerIndex], clustersNumber, std::min(silhouetteBlockSize, entitiesNumber));
+    }
+    const int blocksNumber = (entitiesNumber + silhouetteBlockSize - 1) / silhouetteBlockSize;
+    threadPool.parallelFor(blocksNumber, [&](int blockIndex, int workerIndex){
+        const int firstBlockEntity = blockIndex * silhouetteBlockSize;
+        const int blockSize = std::min(silhouetteBlockSize, entitiesNumber - firstBlockEntity);
+        //clustersDistances(i, b) is the sum of the distances between the b-th datapoint of the block and the datapoints of the i-th cluster
+        auto clustersDistances = storageView<MatrixXf>(workspace.workersClustersDistances[workerIndex], clustersNumber, blockSize);
+        clustersDistances.setZero();
+        if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+            blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, entities.middleRows(firstBlockEntity, blockSize), workspace.workersDistances[workerIndex], [&](int firstEntity, const auto &tileDistances){
+                for(int j=0;j<tileDistances.rows();++j){
+                    clustersDistances.row(labels(firstEntity + j)) += tileDistances.row(j).cwiseSqrt();
+                }
+                //Cancellation in the engine can leave a tiny non zero distance between a datapoint and itself, so we take it back out
+                const int overlapBegin = std::max(firstEntity, firstBlockEntity);
+                const int overlapEnd = std::min(firstEntity + int(tileDistances.rows()), firstBlockEntity + blockSize);
+                for(int j=overlapBegin;j<overlapEnd;++j){
+                    clustersDistances(labels(j), j - firstBlockEntity) -= std::sqrt(tileDistances(j - firstEntity, j - firstBlockEntity));
+                }
+            });
+        }else if(useSimdPanel<Metric>(entities.cols(), blockSize)){
+            //The block serves as the centroids, and the distance between a datapoint and itself is exactly 0
+            blockedPanelDistances(entities, entities.middleRows(firstBlockEntity, blockSize), simdPanelDistances<Metric>(), workspace.workersDistances[workerIndex], [&](int firstEntity, const auto &tileDistances){
+                for(int j=0;j<tileDistances.rows();++j){
+                    clustersDistances.row(labels(firstEntity + j)) += tileDistances.row(j);
+                }
+            });
+        }else{
+            for(int b=0;b<blockSize;++b){
+                const int blockEntity = firstBlockEntity + b;
+                for(int j=0;j<entitiesNumber;++j){
+                    if(j!=blockEntity){
+                        clustersDistances(labels(j), b) += MetricTraits<Metric>::metricDistance(metric(entities.row(blockEntity), entities.row(j)));
+                    }
+                }
+            }
+        }
+        for(int b=0;b<blockSize;++b){
+            silhouettes(firstBlockEntity + b) = silhouetteFromClustersDistances(clustersDistances.col(b), counts, labels(firstBlockEntity + b));
+        }
+    });
+}
+
+/*!
+ * @brief       Computes the simplified silhouette of every datapoint, O(n*k) distances
+ * @details     a(x) and b(x) are replaced by the distances between x and the centroid of its cluster and the closest other centroid
+ * @param[in]   entities                The datapoints
+ * @param[in]   entitiesSquaredNorms    The squared norms of the rows of entities, only read if the metric is SquaredEuclideanMetric
+ * @param[in]   centroids               The centroids of the clusters
+ * @param[in]   labels                  The index of the cluster of each datapoint
+ * @param[in]   metric                  The metric functor you want to use
+ * @param[in]   workspace               The buffers of the distance engine
+ * @param[out]  silhouettes             The simplified silhouette of each datapoint
+*/
+template<typename Metric>
+void simplifiedSilhouettes(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &labels,
+        const Metric                &metric,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXf>               silhouettes
+    ){
+    assert(labels.size()==entities.rows() && silhouettes.size()==entities.rows() && "simplifiedSilhouettes: incompatible sizes\n");
+    const int clustersNumber = centroids.rows();
+    forEachEntityDistances(entities, entitiesSquaredNorms, centroids, metric, workspace, [&](int j, const auto &entityDistances){
+        const float ownDistance = MetricTraits<Metric>::metricDistance(entityDistances(labels(j)));
+        float otherDistance = std::numeric_limits<float>::infinity();
+        for(int i=0;i<clustersNumber;++i){
+            if(i!=labels(j)){
+                otherDistance = std::min(otherDistance, entityDistances(i));
+            }
+        }
+        otherDistance = MetricTraits<Metric>::metricDistance(otherDistance);
+        const float maxDistance = std::max(ownDistance, otherDistance);
+        silhouettes(j) = maxDistance > 0 && clustersNumber > 1 ? (otherDistance - ownDistance) / maxDistance : 0.f;
+    });
+}
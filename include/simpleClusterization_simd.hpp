@@ -0,0 +1,91 @@
+#pragma once
+///@file simpleClusterization_simd.hpp
+///@brief Hand-vectorized distance and argmin kernels, in AVX-512, AVX2 and portable variants chosen at runtime from the capabilities of the CPU
+///@details The kernels work on raw row-major buffers. The centroids are laid out as a panel, the transpose of the centroids matrix with its rows
+///         padded to a multiple of simdPanelWidth with +infinity, so that a single load of a panel row holds the same coordinate of several centroids
+///         and each datapoint is compared to a whole register of centroids at a time, keeping a vectorized running minimum and its index.
+///         The padding centroids are infinitely far from everything, so they never win an argmin.
+///         The x86 variants are compiled with function-level target attributes, so no special build flags are needed and one binary runs on any x86-64 CPU.
+
+#include <Eigen/Dense>
+#include <limits>
+#include <simpleClusterization_common.hpp>
+
+using namespace Eigen;
+
+///The number of floats the rows of a centroids panel are padded to a multiple of, the width of the widest registers the kernels use
+const int simdPanelWidth = 16;
+
+///The instruction sets the kernels come in, from the slowest to the fastest
+enum class SimdLevel{
+    Portable,
+    Avx2,
+    Avx512
+};
+
+///Writes the index and value of the smallest coefficient of each row of a row-major matrix, the first one in case of ties. minima can be nullptr
+typedef void rowsArgmin_t(const float *rows, Index rowsNumber, Index columnsNumber, Index rowsStride, int *indices, float *minima);
+///Writes the distances between each datapoint and every column of a centroids panel, padding included, into the rows of a row-major matrix
+typedef void panelDistances_t(const float *entities, Index entitiesNumber, Index entitiesStride, const float *panel, Index statsNumber, Index panelColumns, float *distances, Index distancesStride);
+///Writes the index of the closest column of a centroids panel to each datapoint and the distance to it, the first one in case of ties. minima can be nullptr
+typedef void panelArgmin_t(const float *entities, Index entitiesNumber, Index entitiesStride, const float *panel, Index statsNumber, Index panelColumns, int *indices, float *minima);
+
+///The kernels of an instruction set
+struct SimdKernels{
+    SimdLevel           level;
+    rowsArgmin_t        *rowsArgmin;
+    panelDistances_t    *squaredEuclideanPanelDistances;
+    panelArgmin_t       *squaredEuclideanPanelArgmin;
+    panelDistances_t    *manhattanPanelDistances;
+    panelArgmin_t       *manhattanPanelArgmin;
+};
+
+///@return The fastest instruction set the CPU and the operating system support
+SimdLevel supportedSimdLevel();
+
+///@return The kernels the library currently runs, those of supportedSimdLevel() unless setSimdLevel() was called
+const SimdKernels &simdKernels();
+
+/*!
+ * @brief       Makes the library run the kernels of another instruction set, e.g. to compare them. It must not be called while the library is running
+ * @param[in]   level   The requested instruction set, lowered to supportedSimdLevel() if the CPU doesn't support it
+ * @return      The instruction set actually selected
+*/
+SimdLevel setSimdLevel(SimdLevel level);
+
+/*!
+ * @brief       Returns the number of columns of the panel of clustersNumber centroids
+ * @param[in]   clustersNumber  The number of centroids
+ * @return      clustersNumber rounded up to a multiple of simdPanelWidth
+*/
+inline Index simdPanelColumns(
+        Index clustersNumber
+    ){
+    return (clustersNumber + simdPanelWidth - 1) / simdPanelWidth * simdPanelWidth;
+}
+
+/*!
+ * @brief       Lays the centroids out as the panel the kernels read
+ * @param[in]   centroids   The centroids, one per row, any expression so that datapoints can serve as centroids without a copy
+ * @param[in-out] storage   The buffer the panel is written to, only grown (see storageView())
+ * @return      A view over the panel, statsNumber x simdPanelColumns(clustersNumber)
+*/
+template<typename DerivedCentroids>
+Map<MatrixXfR> centroidsPanel(
+        const MatrixBase<DerivedCentroids>  &centroids,
+        VectorXf                            &storage
+    ){
+    const Index panelColumns = simdPanelColumns(centroids.rows());
+    auto panel = storageView<MatrixXfR>(storage, centroids.cols(), panelColumns);
+    panel.leftCols(centroids.rows()) = centroids.transpose();
+    panel.rightCols(panelColumns - centroids.rows()).setConstant(std::numeric_limits<float>::infinity());
+    return panel;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMPLECLUSTERIZATION_X86_KERNELS
+///The AVX2 kernels, see simpleClusterization_simd_avx2.cpp
+extern const SimdKernels avx2SimdKernels;
+///The AVX-512 kernels, see simpleClusterization_simd_avx512.cpp
+extern const SimdKernels avx512SimdKernels;
+#endif
@@ -0,0 +1,271 @@
+#pragma once
+///@file simpleClusterization_sparse.hpp
+///@brief Fuzzy memberships truncated to the m closest centroids of each datapoint, and the fuzzy c-means iterations that run on them
+///@details With many clusters almost all the k memberships of a datapoint are close to 0. SparseMemberships keeps only the m largest ones,
+///         renormalized so that they still sum up to 1, as (cluster index, membership) pairs: 8 * m bytes per datapoint instead of 4 * k.
+///         The pairs are selected from each tile of distances as it's computed, so the dense k x n memberships are never built, and the centroids
+///         are updated from the pairs only, reading m memberships per datapoint instead of k.
+///         The truncation changes the algorithm: a datapoint doesn't pull the centroids beyond its m closest ones at all, so the results
+///         approach those of the dense memberships as m grows, and are the same when m equals the number of clusters.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_distances.hpp>
+#include <simpleClusterization_fcm.hpp>
+
+using namespace Eigen;
+
+/*!
+ * @brief   The m largest memberships of each datapoint
+ * @details Row j holds the pairs of the j-th datapoint, from the largest membership down. When there are fewer than m clusters,
+ *          the pairs past the number of clusters have the index -1 and the membership 0
+*/
+struct SparseMemberships{
+    ///The index of the cluster of each pair, n x m
+    MatrixXiR   indices;
+    ///The membership of each pair, n x m
+    MatrixXfR   weights;
+
+    SparseMemberships() = default;
+
+    ///Empty memberships, every pair having the index -1 and the membership 0
+    ///@param[in]   entitiesNumber      The number of datapoints
+    ///@param[in]   membershipsNumber   The number m of memberships kept per datapoint
+    SparseMemberships(
+            Index entitiesNumber,
+            Index membershipsNumber
+        ):
+        indices(MatrixXiR::Constant(entitiesNumber, membershipsNumber, -1)),
+        weights(MatrixXfR::Zero(entitiesNumber, membershipsNumber)){
+    }
+
+    Index entitiesNumber() const{
+        return indices.rows();
+    }
+    Index membershipsNumber() const{
+        return indices.cols();
+    }
+
+    /*!
+     * @brief       Expands the memberships to the dense layout of FCMGenerator(), the memberships that weren't kept being 0
+     * @param[out]  dense   The k x n memberships
+    */
+    void toDense(
+            Ref<MatrixXfR>  dense
+        ) const{
+        assert(dense.cols()==entitiesNumber() && "SparseMemberships::toDense: incompatible matrix sizes\n");
+        dense.setZero();
+        for(Index j=0;j<entitiesNumber();++j){
+            for(Index r=0;r<membershipsNumber() && indices(j, r)>=0;++r){
+                dense(indices(j, r), j) = weights(j, r);
+            }
+        }
+    }
+};
+
+/*!
+ * @brief       Finds the smallest values of a row of distances, in increasing order, by insertion into the values kept so far
+ * @details     This is linear in the number of distances as long as the number of values kept is small, which is what the sparse memberships are for.
+ *              Ties go to the lowest index
+ * @param[in]   distances       The distances to the centroids
+ * @param[in]   clustersNumber  The number of distances
+ * @param[in]   selectedNumber  The number of values to keep
+ * @param[out]  indices         The indices of the smallest distances, min(selectedNumber, clustersNumber) of them are written
+ * @param[out]  values          The smallest distances
+ * @return      The number of values written
+*/
+inline int selectSmallestDistances(
+        const float *distances,
+        int         clustersNumber,
+        int         selectedNumber,
+        int         *indices,
+        float       *values
+    ){
+    const int keptNumber = std::min(selectedNumber, clustersNumber);
+    int size = 0;
+    for(int i=0;i<clustersNumber;++i){
+        const float distance = distances[i];
+        if(size==keptNumber){
+            if(!(distance < values[keptNumber - 1])){
+                continue;
+            }
+            --size;
+        }
+        int position = size;
+        while(position > 0 && distance < values[position - 1]){
+            values[position] = values[position - 1];
+            indices[position] = indices[position - 1];
+            --position;
+        }
+        values[position] = distance;
+        indices[position] = i;
+        ++size;
+    }
+    return keptNumber;
+}
+
+/*!
+ * @brief       With the squared euclidean metric, computes again the distances selected by selectSmallestDistances() that the matrix product formula
+ *              lost to cancellation (see refineSquaredEuclideanDistances()), and sorts them back in increasing order. The selected distances are the smallest ones,
+ *              so they're the most exposed to it. Does nothing for the other metrics, whose distances are computed directly
+ * @param[in]   entity              The datapoint
+ * @param[in]   entitySquaredNorm   The squared norm of the datapoint
+ * @param[in]   centroids           The centroids of the clusters
+ * @param[in]   keptNumber          The number of distances selected
+ * @param[in-out] indices           The indices of the selected distances
+ * @param[in-out] values            The selected distances
+*/
+template<typename Metric, typename DerivedEntity>
+void refineSelectedDistances(
+        const MatrixBase<DerivedEntity> &entity,
+        float                           entitySquaredNorm,
+        const Ref<const MatrixXf>       &centroids,
+        int                             keptNumber,
+        int                             *indices,
+        float                           *values
+    ){
+    if constexpr(MetricTraits<Metric>::isSquaredEuclidean){
+        refineSquaredEuclideanDistances(entity, entitySquaredNorm, centroids, indices, Map<RowVectorXf>(values, keptNumber));
+        for(int s=1;s<keptNumber;++s){
+            const float value = values[s];
+            const int index = indices[s];
+            int position = s;
+            while(position > 0 && value < values[position - 1]){
+                values[position] = values[position - 1];
+                indices[position] = indices[position - 1];
+                --position;
+            }
+            values[position] = value;
+            indices[position] = index;
+        }
+    }
+}
+
+/*!
+ * @brief       Accumulates the sums the centroids are made of from sparse memberships, into the sums of the workspace, which are reset first.
+ *              Each datapoint is only added to the centroids of its pairs
+ * @param[in]   entities        The datapoints
+ * @param[in]   memberships     The memberships
+ * @param[in]   clustersNumber  The number of clusters
+ * @param[in]   fuzziness       The fuzziness exponent m
+ * @param[in-out] workspace     The workspace
+*/
+inline void sparseFcmCentroidsSums(
+        const Ref<const MatrixXfR>  &entities,
+        const SparseMemberships     &memberships,
+        int                         clustersNumber,
+        float                       fuzziness,
+        FcmWorkspace                &workspace
+    ){
+    //The numerators are row-major here, so that adding a datapoint to a centroid is a contiguous update
+    auto centroidsNumerators = storageView<MatrixXfR>(workspace.centroidsNumerators, clustersNumber, entities.cols());
+    auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, clustersNumber, 1);
+    centroidsNumerators.setZero();
+    centroidsDenominators.setZero();
+    for(Index j=0;j<entities.rows();++j){
+        for(Index r=0;r<memberships.membershipsNumber() && memberships.indices(j, r)>=0;++r){
+            const float membership = memberships.weights(j, r);
+            const float powered = fuzziness==2.f ? membership * membership : std::pow(membership, fuzziness);
+            centroidsNumerators.row(memberships.indices(j, r)) += powered * entities.row(j);
+            centroidsDenominators(memberships.indices(j, r)) += powered;
+        }
+    }
+}
+
+/*!
+ * @brief       Sets the centroids to the sums accumulated by sparseFcmCentroidsSums() or updateSparseFcmMemberships().
+ *              A centroid that isn't among the closest ones of any datapoint has no memberships at all, and stays where it is
+ * @param[in-out] centroids The centroids of the clusters
+ * @param[in]   workspace   The workspace holding the sums
+*/
+inline void sparseFcmCentroidsFromSums(
+        Ref<MatrixXf>               centroids,
+        FcmWorkspace                &workspace
+    ){
+    const auto centroidsNumerators = storageView<MatrixXfR>(workspace.centroidsNumerators, centroids.rows(), centroids.cols());
+    const auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, centroids.rows(), 1);
+    for(Index i=0;i<centroids.rows();++i){
+        if(centroidsDenominators(i) > 0){
+            centroids.row(i) = centroidsNumerators.row(i) / centroidsDenominators(i);
+        }
+    }
+}
+
+/*!
+ * @brief       Same as updateFcmMemberships(), keeping only the memberships of the closest centroids of each datapoint, renormalized.
+ *              The sums the next centroids are made of are accumulated at the same time, see sparseFcmCentroidsFromSums()
+ * @param[in]   entities        The datapoints
+ * @param[in]   centroids       The centroids of the clusters
+ * @param[in]   metric          The metric functor you want to use
+ * @param[in]   fuzziness       The fuzziness exponent m, greater than 1
+ * @param[in-out] memberships   The memberships, read to measure their change
+ * @param[in-out] workspace     The workspace, its entitiesSquaredNorms must be up to date for the squared euclidean metric and its sums are reset first
+ * @return      The squared norm of the change of the memberships, as if they were dense
+*/
+template<typename Metric>
+float updateSparseFcmMemberships(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        const Metric                &metric,
+        float                       fuzziness,
+        SparseMemberships           &memberships,
+        FcmWorkspace                &workspace
+    ){
+    assert(memberships.entitiesNumber()==entities.rows() && "updateSparseFcmMemberships: incompatible matrix sizes\n");
+    const int clustersNumber = centroids.rows();
+    const int membershipsNumber = memberships.membershipsNumber();
+    const float ratioExponent = 1.f / (fuzziness - 1.f);
+    const float coincidenceThreshold = FCM_THRESHOLD;
+    double residual = 0;
+    auto centroidsNumerators = storageView<MatrixXfR>(workspace.centroidsNumerators, clustersNumber, entities.cols());
+    auto centroidsDenominators = storageView<VectorXf>(workspace.centroidsDenominators, clustersNumber, 1);
+    auto selectedIndices = storageView<VectorXi>(workspace.selectedIndices, membershipsNumber, 1);
+    auto selectedWeights = storageView<VectorXf>(workspace.selectedWeights, membershipsNumber, 1);
+    const auto entitiesSquaredNorms = storageView<VectorXf>(workspace.entitiesSquaredNorms, MetricTraits<Metric>::isSquaredEuclidean ? entities.rows() : 0, 1);
+    centroidsNumerators.setZero();
+    centroidsDenominators.setZero();
+    auto processTile = [&](int firstEntity, const auto &tileDistances){
+        for(int t=0;t<tileDistances.rows();++t){
+            const int j = firstEntity + t;
+            const int keptNumber = selectSmallestDistances(&tileDistances(t, 0), clustersNumber, membershipsNumber, selectedIndices.data(), selectedWeights.data());
+            refineSelectedDistances<Metric>(entities.row(j), MetricTraits<Metric>::isSquaredEuclidean ? entitiesSquaredNorms(j) : 0.f, centroids, keptNumber,
+                                            selectedIndices.data(), selectedWeights.data());
+            auto kept = selectedWeights.head(keptNumber);
+            const float minDistance = kept(0);
+            if(minDistance <= coincidenceThreshold){
+                kept = (kept.array() <= coincidenceThreshold).template cast<float>().matrix();
+            }else if(fuzziness==2.f){
+                kept = minDistance * kept.cwiseInverse();
+            }else{
+                kept = (minDistance * kept.array().inverse()).pow(ratioExponent).matrix();
+            }
+            kept /= kept.sum();
+            //The squared norm of the change is that of the new memberships, plus that of the old ones, minus twice their product on the common clusters
+            double change = kept.squaredNorm();
+            for(int r=0;r<membershipsNumber && memberships.indices(j, r)>=0;++r){
+                const float previous = memberships.weights(j, r);
+                change += previous * previous;
+                for(int s=0;s<keptNumber;++s){
+                    if(selectedIndices(s)==memberships.indices(j, r)){
+                        change -= 2. * previous * kept(s);
+                    }
+                }
+            }
+            residual += change;
+            memberships.indices.row(j).head(keptNumber) = selectedIndices.head(keptNumber).transpose();
+            memberships.weights.row(j).head(keptNumber) = kept.transpose();
+            memberships.indices.row(j).tail(membershipsNumber - keptNumber).setConstant(-1);
+            memberships.weights.row(j).tail(membershipsNumber - keptNumber).setZero();
+            for(int s=0;s<keptNumber;++s){
+                const float powered = fuzziness==2.f ? kept(s) * kept(s) : std::pow(kept(s), fuzziness);
+                centroidsNumerators.row(selectedIndices(s)) += powered * entities.row(j);
+                centroidsDenominators(selectedIndices(s)) += powered;
+            }
+        }
+    };
+    blockedMetricDistances(entities, entitiesSquaredNorms, centroids, metric, workspace.distances, processTile);
+    return float(residual);
+}
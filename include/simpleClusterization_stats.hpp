@@ -0,0 +1,143 @@
+#pragma once
+///@file simpleClusterization_stats.hpp
+///@brief Optional statistics of the clustering runs: time per phase, iterations, metric evaluations, convergence and the fitness of every sweep run
+///@details A ClusteringStats is attached to a ClusteringContext through ClusteringContext::setStats(), and every function called with that context reports to it.
+///         Nothing is measured when no stats are attached: the library only tests the pointer, at most once per iteration, and doesn't read the clock.
+///         The counters accumulate over the calls until reset(). The recording methods lock a mutex, so the runs of a threaded sweep can share the stats.
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+///The phases the time of a call is split into
+enum class ClusteringPhase{
+    ///The seeding of the centroids, or of the memberships of fuzzy c-means
+    Initialization,
+    ///Assigning the datapoints to the centroids, including the distance computations and the bounds of the bounded algorithms
+    Assignment,
+    ///Moving the centroids to the means of their clusters
+    Update,
+    ///The Davies-Bouldin index and the silhouette
+    Scoring
+};
+
+///The number of values of ClusteringPhase
+const int clusteringPhasesNumber = 4;
+
+///The iterative algorithms that report their iterations
+enum class ClusteringAlgorithm{
+    Lloyd,
+    Hamerly,
+    Elkan,
+    FuzzyCMeans,
+    ///streamingKmeansGenerator(), an iteration is a pass over the dataset
+    MiniBatch
+};
+
+///What the per-iteration callback is told about an iteration
+struct IterationEvent{
+    ClusteringAlgorithm algorithm;
+    ///The number of clusters of the run
+    int                 clustersNumber;
+    ///The index of the iteration within its run, from 0
+    int                 iteration;
+    ///The number of datapoints that changed cluster, -1 for fuzzy c-means and mini-batches
+    int                 changedLabels;
+    ///How much the solution moved: the largest distance a centroid moved for kmeans, the squared norm of the change of the weights for fuzzy c-means,
+    ///the squared norm of the change of the centroids relative to their squared norm for mini-batches
+    float               residual;
+};
+
+///The fitness of one run of a sweep over the number of clusters
+struct ClustersFitness{
+    int     clustersNumber;
+    int     attempt;
+    ///The number of times the run was started over because its fitness was NaN, see maxIterationPerClustersNumber
+    int     retries;
+    ///The Davies-Bouldin index for clusterGeneratorApproximate(), the silhouette for clusterGeneratorExact(), NaN if all the tries failed
+    float   fitness;
+};
+
+/*!
+ * @brief   Collects the statistics of the calls made with the context it's attached to
+ * @note    The fields can be read once the calls are over. The record methods are called by the library
+*/
+class ClusteringStats{
+public:
+    ///The wall time spent in each phase, indexed by ClusteringPhase. The phases of concurrent runs add up, so they can exceed the duration of the call
+    double                      phaseSeconds[clusteringPhasesNumber]    = {};
+    ///The number of runs of the iterative algorithms, and of those that stopped on their iterations limit instead of converging
+    long long                   runs                                    = 0;
+    long long                   unconvergedRuns                         = 0;
+    ///The iterations of all the runs
+    long long                   iterations                              = 0;
+    ///The number of values of the metric computed, the batched engines included. The seeding is timed but its evaluations aren't counted
+    long long                   distanceEvaluations                     = 0;
+    ///The number of times a cluster got empty during a kmeans run
+    long long                   emptyClusterEvents                      = 0;
+    ///The number of times a sweep started a run over because its fitness was NaN
+    long long                   fitnessRetries                          = 0;
+    ///The residual of the last iteration, see IterationEvent::residual
+    float                       lastResidual                            = std::numeric_limits<float>::quiet_NaN();
+    ///The fitness of every run of the sweeps, sorted by number of clusters and attempt within each sweep
+    std::vector<ClustersFitness> clustersFitness;
+    ///If set, called after every iteration of every run. The calls are serialized, but with a threaded sweep they come from the worker threads
+    std::function<void(const IterationEvent&)> onIteration;
+
+    ///Clears the counters, keeping the callback
+    void reset();
+
+    void addPhaseSeconds(ClusteringPhase phase, double seconds);
+    void addDistanceEvaluations(long long count);
+    ///Counts an iteration and the metric evaluations it did, and calls onIteration
+    void recordIteration(const IterationEvent &event, long long iterationDistanceEvaluations);
+    void recordRun(bool converged);
+    void recordEmptyCluster();
+    void recordFitness(const ClustersFitness &fitness);
+    ///Sorts the entries of clustersFitness from firstEntry on, which a threaded sweep records in no particular order
+    void sortClustersFitness(size_t firstEntry);
+
+private:
+    std::mutex                  mutex;
+};
+
+/*!
+ * @brief   Adds the time between its construction and stop() or its destruction to a phase of the stats, if there are some
+ * @details With null stats it doesn't read the clock, so the timers can stay in the library's loops
+*/
+class PhaseTimer{
+public:
+    PhaseTimer(
+            ClusteringStats *stats,
+            ClusteringPhase phase
+        ):
+        stats(stats),
+        phase(phase){
+        if(stats){
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseTimer(){
+        stop();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ///Ends the measure, the destructor then does nothing
+    void stop(){
+        if(stats){
+            stats->addPhaseSeconds(phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            stats = nullptr;
+        }
+    }
+
+private:
+    ClusteringStats                         *stats;
+    ClusteringPhase                         phase;
+    std::chrono::steady_clock::time_point   start;
+};
@@ -0,0 +1,50 @@
+#pragma once
+///@file simpleClusterization_streaming.hpp
+///@brief Building blocks of streamingKmeansGenerator(): mini-batch k-means over datapoints read one chunk at a time
+///@details Each chunk is a mini-batch: its datapoints are assigned to the closest centroid, then every centroid moves towards each of its new
+///         datapoints with a learning rate of 1 / (the number of datapoints it has received so far), as in Sculley's web-scale k-means.
+///         Applied to a whole mini-batch at once this is the running mean of all the datapoints the centroid has received, so only the k x d
+///         centroids, their counts and the current chunk are ever held in memory.
+
+#include <Eigen/Dense>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_kmeans.hpp>
+
+using namespace Eigen;
+
+///Scratch buffers of the streaming functions. They're only grown (see storageView()), so repeated calls don't allocate once the largest sizes have been seen
+struct StreamingWorkspace{
+    ///The buffers of the seeding and of the distance engine
+    KmeansWorkspace     kmeans;
+    ///The datapoints of the current chunk and their squared norms
+    VectorXf            chunk;
+    VectorXf            chunkSquaredNorms;
+    ///The cluster of each datapoint of the current chunk
+    VectorXi            chunkLabels;
+    ///The sums of the datapoints of the current chunk assigned to each centroid
+    VectorXf            centroidsSums;
+    ///The number of datapoints of the current chunk assigned to each centroid
+    VectorXi            chunkCounts;
+    ///The number of datapoints each centroid has received since the start of the run, they set its learning rate
+    VectorXd            centroidsWeights;
+    ///The centroids at the start of the current pass, to measure how much they moved
+    VectorXf            passCentroids;
+};
+
+/*!
+ * @brief       Moves the centroids towards the datapoints of a mini-batch, each with a learning rate of 1 / (the datapoints it has received so far)
+ * @param[in]   chunk               The datapoints of the mini-batch
+ * @param[in]   chunkLabels         The index of the closest centroid to each datapoint of the mini-batch
+ * @param[in-out] centroids         The centroids of the clusters
+ * @param[in-out] centroidsWeights  The number of datapoints each centroid has received, the mini-batch is added to it
+ * @param[out]  centroidsSums       Scratch space for the sums of the datapoints of each cluster, k x d
+ * @param[out]  chunkCounts         The number of datapoints of the mini-batch assigned to each centroid
+*/
+void miniBatchUpdate(
+        const Ref<const MatrixXfR>  &chunk,
+        const Ref<const VectorXi>   &chunkLabels,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXd>               centroidsWeights,
+        Ref<MatrixXf>               centroidsSums,
+        Ref<VectorXi>               chunkCounts
+    );
@@ -0,0 +1,73 @@
+#pragma once
+///@file simpleClusterization_threadPool.hpp
+///@brief A minimal work-stealing thread pool, used to spread independent clusterization jobs over several cores
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*!
+ * @brief   A fixed set of worker threads that run batches of indexed jobs.
+ * @details Every batch is split in contiguous ranges, one per worker, in the order the jobs are numbered. A worker consumes its own range from the front,
+ *          and when it's done it steals from the back of the other workers' ranges, so callers should number the most expensive jobs first.
+ *          The thread calling parallelFor() takes part in the batch as worker 0, so a pool of size 1 spawns no thread at all.
+ *          A pool runs one batch at a time, parallelFor() must not be called from inside one of its jobs.
+*/
+class ThreadPool{
+public:
+    ///@param[in]   threadsNumber   The number of workers, including the calling thread. 0 means one per hardware thread
+    explicit ThreadPool(int threadsNumber = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ///@return The number of workers, including the calling thread
+    int size() const{
+        return int(queues.size());
+    }
+
+    /*!
+     * @brief       Runs job(jobIndex, workerIndex) for every jobIndex in [0, jobsNumber) and returns when all of them are done
+     * @details     workerIndex is in [0, size()) and no two jobs with the same workerIndex run concurrently, so it can be used to index per-worker scratch buffers
+     * @param[in]   jobsNumber  The number of jobs in the batch
+     * @param[in]   job         A callable with signature void(int jobIndex, int workerIndex)
+    */
+    template<typename Job>
+    void parallelFor(
+            int     jobsNumber,
+            Job     &&job
+        ){
+        run(jobsNumber, [](void *context, int jobIndex, int workerIndex){
+            (*static_cast<typename std::remove_reference<Job>::type*>(context))(jobIndex, workerIndex);
+        }, const_cast<void*>(static_cast<const void*>(&job)));
+    }
+
+private:
+    typedef void jobTrampoline_t(void *context, int jobIndex, int workerIndex);
+
+    ///The range of jobs [begin, end) still owned by a worker
+    struct JobQueue{
+        std::mutex  mutex;
+        int         begin = 0;
+        int         end = 0;
+    };
+
+    void run(int jobsNumber, jobTrampoline_t *trampoline, void *context);
+    void workerLoop(int workerIndex);
+    void consumeJobs(int workerIndex);
+    bool nextJob(int workerIndex, int &jobIndex);
+
+    std::vector<std::unique_ptr<JobQueue>>  queues;
+    std::vector<std::thread>                threads;
+    std::mutex                              batchMutex;
+    std::condition_variable                 batchStarted;
+    std::condition_variable                 batchFinished;
+    jobTrampoline_t                         *currentTrampoline = nullptr;
+    void                                    *currentContext = nullptr;
+    unsigned long                           batchGeneration = 0;
+    int                                     busyWorkers = 0;
+    bool                                    stopping = false;
+};
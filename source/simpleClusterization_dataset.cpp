@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <simpleClusterization_dataset.hpp>
+
+using namespace Eigen;
+
+namespace{
+
+const char datasetMagic[8] = "SCLDATA";
+
+DatasetHeader makeHeader(
+        DatasetType     type,
+        DatasetLayout   layout,
+        Index           rows,
+        Index           cols
+    ){
+    DatasetHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, datasetMagic, sizeof(datasetMagic));
+    header.version  = datasetFormatVersion;
+    header.type     = std::uint32_t(type);
+    header.layout   = std::uint32_t(layout);
+    header.rows     = std::uint64_t(rows);
+    header.cols     = std::uint64_t(cols);
+    return header;
+}
+
+///Writes the header and the payload, the payload is produced by writePayload(file) which returns false on failure
+template<typename PayloadWriter>
+bool writeFile(
+        const std::string   &path,
+        const DatasetHeader &header,
+        PayloadWriter       &&writePayload
+    ){
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file){
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file)==1 && writePayload(file);
+    written = std::fclose(file)==0 && written;
+    return written;
+}
+
+}
+
+MappedDataset::~MappedDataset(){
+    close();
+}
+
+bool MappedDataset::open(
+        const std::string   &path
+    ){
+    close();
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if(descriptor<0){
+        return false;
+    }
+    struct stat status;
+    if(fstat(descriptor, &status)!=0 || std::size_t(status.st_size) < sizeof(DatasetHeader)){
+        ::close(descriptor);
+        return false;
+    }
+    void *newMapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    //The mapping keeps the file alive, the descriptor isn't needed anymore
+    ::close(descriptor);
+    if(newMapping==MAP_FAILED){
+        return false;
+    }
+    const DatasetHeader &newHeader = *static_cast<const DatasetHeader*>(newMapping);
+    const bool validHeader = std::memcmp(newHeader.magic, datasetMagic, sizeof(datasetMagic))==0
+                          && newHeader.version==datasetFormatVersion
+                          && newHeader.type<=std::uint32_t(DatasetType::Int32)
+                          && newHeader.layout<=std::uint32_t(DatasetLayout::ColumnMajor)
+                          && (newHeader.cols==0 || newHeader.rows <= (std::uint64_t(status.st_size) - sizeof(DatasetHeader)) / 4 / newHeader.cols);
+    if(!validHeader){
+        munmap(newMapping, status.st_size);
+        return false;
+    }
+    mapping = newMapping;
+    mappingSize = status.st_size;
+    return true;
+}
+
+void MappedDataset::close(){
+    if(mapping){
+        munmap(const_cast<void*>(mapping), mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+Map<const MatrixXfR> MappedDataset::entities() const{
+    assert(isOpen() && type()==DatasetType::Float32 && layout()==DatasetLayout::RowMajor && "MappedDataset::entities: not a RowMajor Float32 file\n");
+    return Map<const MatrixXfR>(static_cast<const float*>(payload()), rows(), cols());
+}
+
+Map<const MatrixXf> MappedDataset::columnMajorEntities() const{
+    assert(isOpen() && type()==DatasetType::Float32 && layout()==DatasetLayout::ColumnMajor && "MappedDataset::columnMajorEntities: not a ColumnMajor Float32 file\n");
+    return Map<const MatrixXf>(static_cast<const float*>(payload()), rows(), cols());
+}
+
+Map<const VectorXi> MappedDataset::labels() const{
+    assert(isOpen() && type()==DatasetType::Int32 && cols()==1 && "MappedDataset::labels: not an Int32 file with a single column\n");
+    return Map<const VectorXi>(static_cast<const int*>(payload()), rows());
+}
+
+MappedDataset::ChunkSource MappedDataset::chunkSource() const{
+    assert(isOpen() && type()==DatasetType::Float32 && layout()==DatasetLayout::RowMajor && "MappedDataset::chunkSource: not a RowMajor Float32 file\n");
+    return ChunkSource{this, 0};
+}
+
+int MappedDataset::ChunkSource::operator()(
+        Ref<MatrixXfR>  chunk
+    ){
+    assert(chunk.cols()==dataset->cols() && "MappedDataset::ChunkSource: the chunk has the wrong number of columns\n");
+    const int chunkRows = int(std::min(Index(chunk.rows()), dataset->rows() - position));
+    if(chunkRows==0){
+        position = 0;
+        return 0;
+    }
+    chunk.topRows(chunkRows) = dataset->entities().middleRows(position, chunkRows);
+    position += chunkRows;
+    return chunkRows;
+}
+
+bool writeDataset(
+        const std::string           &path,
+        const Ref<const MatrixXfR>  &matrix,
+        DatasetLayout               layout
+    ){
+    return writeFile(path, makeHeader(DatasetType::Float32, layout, matrix.rows(), matrix.cols()), [&](std::FILE *file){
+        if(layout==DatasetLayout::RowMajor){
+            for(Index j=0;j<matrix.rows();++j){
+                if(std::fwrite(matrix.row(j).data(), sizeof(float), matrix.cols(), file)!=std::size_t(matrix.cols())){
+                    return false;
+                }
+            }
+            return true;
+        }
+        //The columns aren't contiguous in a MatrixXfR, so they go through a buffer one at a time
+        VectorXf column(matrix.rows());
+        for(Index i=0;i<matrix.cols();++i){
+            column = matrix.col(i);
+            if(std::fwrite(column.data(), sizeof(float), column.size(), file)!=std::size_t(column.size())){
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool writeDataset(
+        const std::string           &path,
+        const Ref<const VectorXi>   &labels
+    ){
+    return writeFile(path, makeHeader(DatasetType::Int32, DatasetLayout::RowMajor, labels.size(), 1), [&](std::FILE *file){
+        return std::fwrite(labels.data(), sizeof(int), labels.size(), file)==std::size_t(labels.size());
+    });
+}
@@ -0,0 +1,137 @@
+#include <Eigen/Dense>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization.hpp>
+#include <simpleClusterization_distances.hpp>
+
+using namespace Eigen;
+
+void squaredEuclideanDistances(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        Ref<MatrixXfR>              distances
+    ){
+    assert(distances.rows()==centroids.rows() && distances.cols()==entities.rows() && "squaredEuclideanDistances: incompatible matrix sizes\n");
+    const VectorXf entitiesSquaredNorms = entities.rowwise().squaredNorm();
+    blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, [&](int firstEntity, const auto &tileDistances){
+        distances.middleCols(firstEntity, tileDistances.rows()) = tileDistances.transpose();
+    });
+}
+
+int squaredEuclideanLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    ){
+    if(useSimdPanel<SquaredEuclideanMetric>(entities.cols(), centroids.rows())){
+        return panelLabels(entities, centroids, simdKernels().squaredEuclideanPanelArgmin, workspace, labels, nearestDistances);
+    }
+    auto centroidsSquaredNorms = storageView<RowVectorXf>(workspace.centroidsSquaredNorms, 1, centroids.rows());
+    centroidsSquaredNorms = centroids.rowwise().squaredNorm().transpose();
+    return preparedSquaredEuclideanLabels(entities, entitiesSquaredNorms, centroids, centroidsSquaredNorms, workspace, labels, nearestDistances);
+}
+
+int preparedSquaredEuclideanLabels(
+        const Ref<const MatrixXfR>      &entities,
+        const Ref<const VectorXf>       &entitiesSquaredNorms,
+        const Ref<const MatrixXf>       &centroids,
+        const Ref<const RowVectorXf>    &centroidsSquaredNorms,
+        DistanceWorkspace               &workspace,
+        Ref<VectorXi>                   labels,
+        Ref<VectorXf>                   *nearestDistances
+    ){
+    rowsArgmin_t *rowsArgmin = simdKernels().rowsArgmin;
+    int changedLabels = 0;
+    blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, centroidsSquaredNorms, workspace, [&](int firstEntity, const auto &tileDistances){
+        auto tileLabels = storageView<VectorXi>(workspace.tileLabels, tileDistances.rows(), 1);
+        rowsArgmin(tileDistances.data(), tileDistances.rows(), tileDistances.cols(), tileDistances.outerStride(), tileLabels.data(), nullptr);
+        changedLabels += (labels.segment(firstEntity, tileDistances.rows()).array()!=tileLabels.array()).count();
+        labels.segment(firstEntity, tileDistances.rows()) = tileLabels;
+        //The product formula loses precision to cancellation, so the distances to the closest centroids are computed again while the tile is in cache
+        if(nearestDistances){
+            for(int j=0;j<tileDistances.rows();++j){
+                (*nearestDistances)(firstEntity + j) = SquaredEuclideanMetric()(centroids.row(tileLabels(j)), entities.row(firstEntity + j));
+            }
+        }
+    });
+    return changedLabels;
+}
+
+int panelLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        panelArgmin_t               *kernel,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    ){
+    assert(entities.cols()==centroids.cols() && "panelLabels: incompatible matrix sizes\n");
+    return preparedPanelLabels(entities, centroidsPanel(centroids, workspace.centroidsPanel), kernel, workspace, labels, nearestDistances);
+}
+
+int preparedPanelLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXfR>  &panel,
+        panelArgmin_t               *kernel,
+        DistanceWorkspace           &workspace,
+        Ref<VectorXi>               labels,
+        Ref<VectorXf>               *nearestDistances
+    ){
+    assert(entities.cols()==panel.rows() && labels.size()==entities.rows() && "preparedPanelLabels: incompatible matrix sizes\n");
+    const int entitiesNumber = entities.rows();
+    const int tileRows = std::min(distanceTileRows(entities.cols(), panel.cols()), entitiesNumber);
+    auto tileLabels = storageView<VectorXi>(workspace.tileLabels, tileRows, 1);
+    int changedLabels = 0;
+    for(int firstEntity=0;firstEntity<entitiesNumber;firstEntity+=tileRows){
+        const int currentRows = std::min(tileRows, entitiesNumber - firstEntity);
+        kernel(entities.row(firstEntity).data(), currentRows, entities.outerStride(), panel.data(), panel.rows(), panel.cols(), tileLabels.data(), nearestDistances ? nearestDistances->data() + firstEntity : nullptr);
+        changedLabels += (labels.segment(firstEntity, currentRows).array()!=tileLabels.head(currentRows).array()).count();
+        labels.segment(firstEntity, currentRows) = tileLabels.head(currentRows);
+    }
+    return changedLabels;
+}
+
+void squaredEuclideanFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXf>   &entitiesSquaredNorms,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<MatrixXfR>              weights
+    ){
+    auto centroidsSquaredNorms = storageView<RowVectorXf>(workspace.centroidsSquaredNorms, 1, centroids.rows());
+    centroidsSquaredNorms = centroids.rowwise().squaredNorm().transpose();
+    squaredEuclideanFuzzyWeights(entities, entitiesSquaredNorms, centroids, centroidsSquaredNorms, workspace, weights);
+}
+
+void squaredEuclideanFuzzyWeights(
+        const Ref<const MatrixXfR>      &entities,
+        const Ref<const VectorXf>       &entitiesSquaredNorms,
+        const Ref<const MatrixXf>       &centroids,
+        const Ref<const RowVectorXf>    &centroidsSquaredNorms,
+        DistanceWorkspace               &workspace,
+        Ref<MatrixXfR>                  weights
+    ){
+    blockedSquaredEuclideanDistances(entities, entitiesSquaredNorms, centroids, centroidsSquaredNorms, workspace, [&](int firstEntity, const auto &tileDistances){
+        auto tileWeights = weights.middleCols(firstEntity, tileDistances.rows());
+        tileWeights = tileDistances.transpose();
+        for(int j=0;j<tileDistances.rows();++j){
+            refineSquaredEuclideanDistances(entities.row(firstEntity + j), entitiesSquaredNorms(firstEntity + j), centroids, nullptr, tileWeights.col(j));
+        }
+        assert((tileWeights.array() > FCM_THRESHOLD).all() && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+        tileWeights = tileWeights.cwiseInverse();
+    });
+}
+
+void manhattanFuzzyWeights(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const MatrixXf>   &centroids,
+        DistanceWorkspace           &workspace,
+        Ref<MatrixXfR>              weights
+    ){
+    blockedPanelDistances(entities, centroids, simdKernels().manhattanPanelDistances, workspace, [&](int firstEntity, const auto &tileDistances){
+        assert((tileDistances.array() > FCM_THRESHOLD).all() && "A centroid and an entity coincide, this leads to infinite weights, correct\n");
+        weights.middleCols(firstEntity, tileDistances.rows()) = tileDistances.transpose().cwiseInverse();
+    });
+}
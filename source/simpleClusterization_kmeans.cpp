@@ -0,0 +1,26 @@
+#include <Eigen/Dense>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_kmeans.hpp>
+
+using namespace Eigen;
+
+bool updateCentroidsFromLabels(
+        const Ref<const MatrixXfR>  &entities,
+        const Ref<const VectorXi>   &labels,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXi>               counts
+    ){
+    const int entitiesNumber = entities.rows();
+    const int clustersNumber = centroids.rows();
+    centroids.setZero();
+    counts.setZero();
+    for(int j=0;j<entitiesNumber;++j){
+        centroids.row(labels(j)) += entities.row(j);
+        ++counts(labels(j));
+    }
+    for(int i=0;i<clustersNumber;++i){
+        float multiplier  = 1.0 / (float) counts(i);
+        centroids.row(i) *= multiplier;
+    }
+    return counts.minCoeff() > 0;
+}
@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <Eigen/Dense>
+#include <simpleClusterization.hpp>
+#include <simpleClusterization_model.hpp>
+
+using namespace Eigen;
+
+namespace{
+
+const char modelMagic[8] = "SCLMODL";
+
+///The header at the start of a model file, padded to 64 bytes like DatasetHeader
+struct ModelHeader{
+    ///Always "SCLMODL" followed by a null byte
+    char            magic[8];
+    ///The version of the format, modelFormatVersion
+    std::uint32_t   version;
+    std::uint32_t   reserved;
+    std::uint64_t   clustersNumber;
+    std::uint64_t   statsNumber;
+    std::uint8_t    padding[32];
+};
+static_assert(sizeof(ModelHeader)==64, "ModelHeader must be 64 bytes long");
+
+}
+
+void ClusteringModel::setCentroids(
+        const Ref<const MatrixXf>   &centroids,
+        const Ref<const VectorXi>   &counts
+    ){
+    assert(counts.size()==centroids.rows() && "ClusteringModel::setCentroids: incompatible matrix sizes\n");
+    modelCentroids = centroids;
+    modelCounts = counts.cast<double>();
+    prepare();
+}
+
+void ClusteringModel::prepare(){
+    centroidsSquaredNorms = modelCentroids.rowwise().squaredNorm().transpose();
+    centroidsPanel(modelCentroids, panelStorage);
+}
+
+bool ClusteringModel::save(
+        const std::string &path
+    ) const{
+    ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, modelMagic, sizeof(modelMagic));
+    header.version          = modelFormatVersion;
+    header.clustersNumber   = std::uint64_t(clustersNumber());
+    header.statsNumber      = std::uint64_t(statsNumber());
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file){
+        return false;
+    }
+    const MatrixXfR centroids = modelCentroids;
+    bool written = std::fwrite(&header, sizeof(header), 1, file)==1
+                && std::fwrite(centroids.data(), sizeof(float), centroids.size(), file)==std::size_t(centroids.size())
+                && std::fwrite(modelCounts.data(), sizeof(double), modelCounts.size(), file)==std::size_t(modelCounts.size());
+    written = std::fclose(file)==0 && written;
+    return written;
+}
+
+bool ClusteringModel::load(
+        const std::string &path
+    ){
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if(!file){
+        return false;
+    }
+    ModelHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file)==1
+              && std::memcmp(header.magic, modelMagic, sizeof(modelMagic))==0
+              && header.version==modelFormatVersion
+              && header.clustersNumber < (std::uint64_t(1) << 31) && header.statsNumber < (std::uint64_t(1) << 31);
+    //The payload size is checked against the file before anything is allocated from the header
+    if(valid){
+        const std::uint64_t payloadBytes = header.clustersNumber * (header.statsNumber * sizeof(float) + sizeof(double));
+        valid = std::fseek(file, 0, SEEK_END)==0 && std::uint64_t(std::ftell(file))==sizeof(header) + payloadBytes
+             && std::fseek(file, long(sizeof(header)), SEEK_SET)==0;
+    }
+    MatrixXfR centroids;
+    VectorXd counts;
+    if(valid){
+        centroids.resize(Index(header.clustersNumber), Index(header.statsNumber));
+        counts.resize(Index(header.clustersNumber));
+        valid = std::fread(centroids.data(), sizeof(float), centroids.size(), file)==std::size_t(centroids.size())
+             && std::fread(counts.data(), sizeof(double), counts.size(), file)==std::size_t(counts.size());
+    }
+    std::fclose(file);
+    if(!valid){
+        return false;
+    }
+    modelCentroids = centroids;
+    modelCounts.swap(counts);
+    prepare();
+    return true;
+}
@@ -0,0 +1,189 @@
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_simd.hpp>
+
+using namespace Eigen;
+
+//The portable kernels are plain loops over blocks of simdPanelWidth centroids, written so that the compiler can vectorize them for the baseline instruction set
+
+static void portableRowsArgmin(
+        const float *rows,
+        Index       rowsNumber,
+        Index       columnsNumber,
+        Index       rowsStride,
+        int         *indices,
+        float       *minima
+    ){
+    for(Index j=0;j<rowsNumber;++j){
+        const float *row = rows + j * rowsStride;
+        float minDistance = row[0];
+        int minIndex = 0;
+        for(Index i=1;i<columnsNumber;++i){
+            if(row[i] < minDistance){
+                minDistance = row[i];
+                minIndex = int(i);
+            }
+        }
+        indices[j] = minIndex;
+        if(minima){
+            minima[j] = minDistance;
+        }
+    }
+}
+
+struct PortableSquaredDifference{
+    static float apply(float difference){
+        return difference * difference;
+    }
+};
+
+struct PortableAbsoluteDifference{
+    static float apply(float difference){
+        return std::fabs(difference);
+    }
+};
+
+///Computes the distances between a datapoint and a block of simdPanelWidth centroids into local accumulators, which the compiler keeps in registers
+template<typename Difference>
+static inline void portableBlockDistances(
+        const float *entity,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        float       (&distances)[simdPanelWidth]
+    ){
+    float accumulators[simdPanelWidth] = {};
+    for(Index s=0;s<statsNumber;++s){
+        const float coordinate = entity[s];
+        const float *panelRow = panel + s * panelColumns;
+        for(int l=0;l<simdPanelWidth;++l){
+            accumulators[l] += Difference::apply(coordinate - panelRow[l]);
+        }
+    }
+    for(int l=0;l<simdPanelWidth;++l){
+        distances[l] = accumulators[l];
+    }
+}
+
+template<typename Difference>
+static void portablePanelDistances(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        float       *distances,
+        Index       distancesStride
+    ){
+    float blockDistances[simdPanelWidth];
+    for(Index j=0;j<entitiesNumber;++j){
+        for(Index block=0;block<panelColumns;block+=simdPanelWidth){
+            portableBlockDistances<Difference>(entities + j * entitiesStride, panel + block, statsNumber, panelColumns, blockDistances);
+            std::copy(blockDistances, blockDistances + simdPanelWidth, distances + j * distancesStride + block);
+        }
+    }
+}
+
+template<typename Difference>
+static void portablePanelArgmin(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        int         *indices,
+        float       *minima
+    ){
+    float blockDistances[simdPanelWidth];
+    float best[simdPanelWidth];
+    int bestIndices[simdPanelWidth];
+    for(Index j=0;j<entitiesNumber;++j){
+        //A running minimum per lane like the x86 kernels, without branches so that it vectorizes too
+        std::fill(best, best + simdPanelWidth, std::numeric_limits<float>::infinity());
+        std::fill(bestIndices, bestIndices + simdPanelWidth, 0);
+        for(Index block=0;block<panelColumns;block+=simdPanelWidth){
+            portableBlockDistances<Difference>(entities + j * entitiesStride, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int l=0;l<simdPanelWidth;++l){
+                const bool smaller = blockDistances[l] < best[l];
+                best[l] = smaller ? blockDistances[l] : best[l];
+                bestIndices[l] = smaller ? int(block) + l : bestIndices[l];
+            }
+        }
+        float minDistance = best[0];
+        int minIndex = bestIndices[0];
+        for(int l=1;l<simdPanelWidth;++l){
+            if(best[l] < minDistance || (best[l]==minDistance && bestIndices[l] < minIndex)){
+                minDistance = best[l];
+                minIndex = bestIndices[l];
+            }
+        }
+        indices[j] = minIndex;
+        if(minima){
+            minima[j] = minDistance;
+        }
+    }
+}
+
+static const SimdKernels portableSimdKernels = {
+    SimdLevel::Portable,
+    portableRowsArgmin,
+    portablePanelDistances<PortableSquaredDifference>,
+    portablePanelArgmin<PortableSquaredDifference>,
+    portablePanelDistances<PortableAbsoluteDifference>,
+    portablePanelArgmin<PortableAbsoluteDifference>
+};
+
+SimdLevel supportedSimdLevel(){
+#ifdef SIMPLECLUSTERIZATION_X86_KERNELS
+    //__builtin_cpu_supports also checks that the operating system saves the wide registers
+    static const SimdLevel level = __builtin_cpu_supports("avx512f") ? SimdLevel::Avx512
+                                 : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? SimdLevel::Avx2
+                                 : SimdLevel::Portable;
+    return level;
+#else
+    return SimdLevel::Portable;
+#endif
+}
+
+///Returns the kernels of an instruction set the CPU supports
+static const SimdKernels *kernelsOf(
+        SimdLevel level
+    ){
+#ifdef SIMPLECLUSTERIZATION_X86_KERNELS
+    if(level==SimdLevel::Avx512){
+        return &avx512SimdKernels;
+    }
+    if(level==SimdLevel::Avx2){
+        return &avx2SimdKernels;
+    }
+#endif
+    return &portableSimdKernels;
+}
+
+///The kernels in use, nullptr until they're first needed
+static std::atomic<const SimdKernels*> currentSimdKernels(nullptr);
+
+const SimdKernels &simdKernels(){
+    const SimdKernels *kernels = currentSimdKernels.load(std::memory_order_acquire);
+    if(!kernels){
+        kernels = kernelsOf(supportedSimdLevel());
+        currentSimdKernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+SimdLevel setSimdLevel(
+        SimdLevel level
+    ){
+    const SimdLevel supported = supportedSimdLevel();
+    if(int(level) > int(supported)){
+        level = supported;
+    }
+    currentSimdKernels.store(kernelsOf(level), std::memory_order_release);
+    return level;
+}
@@ -0,0 +1,197 @@
+#include <Eigen/Dense>
+#include <limits>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_simd.hpp>
+
+#ifdef SIMPLECLUSTERIZATION_X86_KERNELS
+#include <immintrin.h>
+
+using namespace Eigen;
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+///The number of registers of centroids a datapoint is compared to at once, 32 centroids
+const int avx2BlockRegisters = 4;
+
+///Returns the first remaining lanes of a register as a mask
+AVX2_TARGET static inline __m256i avx2LanesMask(
+        Index remaining
+    ){
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(int(std::min<Index>(remaining, 8))), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+///Keeps the smaller of values and best in every lane, and the index of the one that was kept, the earlier one in case of ties
+AVX2_TARGET static inline void avx2RunningArgmin(
+        __m256      values,
+        __m256i     valuesIndices,
+        __m256      &best,
+        __m256i     &bestIndices
+    ){
+    const __m256 smaller = _mm256_cmp_ps(values, best, _CMP_LT_OQ);
+    best = _mm256_blendv_ps(best, values, smaller);
+    bestIndices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndices), _mm256_castsi256_ps(valuesIndices), smaller));
+}
+
+///Reduces the lanes of a running argmin to the smallest value and the lowest index holding it, without leaving the registers
+AVX2_TARGET static inline void avx2ReduceArgmin(
+        __m256      best,
+        __m256i     bestIndices,
+        int         &index,
+        float       &minimum
+    ){
+    //Every lane ends up holding the minimum of all lanes
+    __m256 minima = _mm256_min_ps(best, _mm256_permute2f128_ps(best, best, 0x01));
+    minima = _mm256_min_ps(minima, _mm256_permute_ps(minima, 0x4E));
+    minima = _mm256_min_ps(minima, _mm256_permute_ps(minima, 0xB1));
+    //best starts at +infinity and NaNs never compare lower, so at least one lane holds the minimum
+    const __m256 minimumLanes = _mm256_cmp_ps(best, minima, _CMP_EQ_OQ);
+    __m256i candidates = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(_mm256_set1_epi32(std::numeric_limits<int>::max())), _mm256_castsi256_ps(bestIndices), minimumLanes));
+    candidates = _mm256_min_epi32(candidates, _mm256_permute2x128_si256(candidates, candidates, 0x01));
+    candidates = _mm256_min_epi32(candidates, _mm256_shuffle_epi32(candidates, 0x4E));
+    candidates = _mm256_min_epi32(candidates, _mm256_shuffle_epi32(candidates, 0xB1));
+    minimum = _mm256_cvtss_f32(minima);
+    index = _mm256_cvtsi256_si32(candidates);
+}
+
+AVX2_TARGET static void avx2RowsArgmin(
+        const float *rows,
+        Index       rowsNumber,
+        Index       columnsNumber,
+        Index       rowsStride,
+        int         *indices,
+        float       *minima
+    ){
+    const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    for(Index j=0;j<rowsNumber;++j){
+        const float *row = rows + j * rowsStride;
+        __m256 best = infinity;
+        __m256i bestIndices = _mm256_setzero_si256();
+        __m256i columnsIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        Index i = 0;
+        for(;i + 8<=columnsNumber;i+=8){
+            avx2RunningArgmin(_mm256_loadu_ps(row + i), columnsIndices, best, bestIndices);
+            columnsIndices = _mm256_add_epi32(columnsIndices, _mm256_set1_epi32(8));
+        }
+        if(i < columnsNumber){
+            const __m256i mask = avx2LanesMask(columnsNumber - i);
+            const __m256 values = _mm256_blendv_ps(infinity, _mm256_maskload_ps(row + i, mask), _mm256_castsi256_ps(mask));
+            avx2RunningArgmin(values, columnsIndices, best, bestIndices);
+        }
+        float minimum;
+        avx2ReduceArgmin(best, bestIndices, indices[j], minimum);
+        if(minima){
+            minima[j] = minimum;
+        }
+    }
+}
+
+///Computes the distances between a datapoint and Registers registers of centroids of the panel
+template<bool Squared, int Registers>
+AVX2_TARGET static inline void avx2BlockDistances(
+        const float *entity,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        __m256      *distances
+    ){
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+#pragma GCC unroll 4
+    for(int r=0;r<Registers;++r){
+        distances[r] = _mm256_setzero_ps();
+    }
+    for(Index s=0;s<statsNumber;++s){
+        const __m256 coordinate = _mm256_set1_ps(entity[s]);
+        const float *panelRow = panel + s * panelColumns;
+#pragma GCC unroll 4
+        for(int r=0;r<Registers;++r){
+            const __m256 difference = _mm256_sub_ps(coordinate, _mm256_loadu_ps(panelRow + 8 * r));
+            if constexpr(Squared){
+                distances[r] = _mm256_fmadd_ps(difference, difference, distances[r]);
+            }else{
+                distances[r] = _mm256_add_ps(distances[r], _mm256_andnot_ps(signMask, difference));
+            }
+        }
+    }
+}
+
+template<bool Squared>
+AVX2_TARGET static void avx2PanelDistances(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        float       *distances,
+        Index       distancesStride
+    ){
+    __m256 blockDistances[avx2BlockRegisters];
+    for(Index j=0;j<entitiesNumber;++j){
+        const float *entity = entities + j * entitiesStride;
+        float *entityDistances = distances + j * distancesStride;
+        Index block = 0;
+        for(;block + 8 * avx2BlockRegisters<=panelColumns;block+=8 * avx2BlockRegisters){
+            avx2BlockDistances<Squared, avx2BlockRegisters>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int r=0;r<avx2BlockRegisters;++r){
+                _mm256_storeu_ps(entityDistances + block + 8 * r, blockDistances[r]);
+            }
+        }
+        //The panel columns are a multiple of 16, so what's left is one pair of registers
+        if(block < panelColumns){
+            avx2BlockDistances<Squared, 2>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            _mm256_storeu_ps(entityDistances + block, blockDistances[0]);
+            _mm256_storeu_ps(entityDistances + block + 8, blockDistances[1]);
+        }
+    }
+}
+
+template<bool Squared>
+AVX2_TARGET static void avx2PanelArgmin(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        int         *indices,
+        float       *minima
+    ){
+    __m256 blockDistances[avx2BlockRegisters];
+    for(Index j=0;j<entitiesNumber;++j){
+        const float *entity = entities + j * entitiesStride;
+        __m256 best = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+        __m256i bestIndices = _mm256_setzero_si256();
+        __m256i columnsIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        Index block = 0;
+        for(;block + 8 * avx2BlockRegisters<=panelColumns;block+=8 * avx2BlockRegisters){
+            avx2BlockDistances<Squared, avx2BlockRegisters>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int r=0;r<avx2BlockRegisters;++r){
+                avx2RunningArgmin(blockDistances[r], columnsIndices, best, bestIndices);
+                columnsIndices = _mm256_add_epi32(columnsIndices, _mm256_set1_epi32(8));
+            }
+        }
+        if(block < panelColumns){
+            avx2BlockDistances<Squared, 2>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int r=0;r<2;++r){
+                avx2RunningArgmin(blockDistances[r], columnsIndices, best, bestIndices);
+                columnsIndices = _mm256_add_epi32(columnsIndices, _mm256_set1_epi32(8));
+            }
+        }
+        float minimum;
+        avx2ReduceArgmin(best, bestIndices, indices[j], minimum);
+        if(minima){
+            minima[j] = minimum;
+        }
+    }
+}
+
+const SimdKernels avx2SimdKernels = {
+    SimdLevel::Avx2,
+    avx2RowsArgmin,
+    avx2PanelDistances<true>,
+    avx2PanelArgmin<true>,
+    avx2PanelDistances<false>,
+    avx2PanelArgmin<false>
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include <Eigen/Dense>
+#include <limits>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_simd.hpp>
+
+#ifdef SIMPLECLUSTERIZATION_X86_KERNELS
+#include <immintrin.h>
+
+//The AVX-512 intrinsics of GCC 12 start from deliberately undefined registers, which trips -Wmaybe-uninitialized once they're inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+using namespace Eigen;
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+///The number of registers of centroids a datapoint is compared to at once, 64 centroids
+const int avx512BlockRegisters = 4;
+
+///Keeps the smaller of values and best in every lane, and the index of the one that was kept, the earlier one in case of ties
+AVX512_TARGET static inline void avx512RunningArgmin(
+        __m512      values,
+        __m512i     valuesIndices,
+        __m512      &best,
+        __m512i     &bestIndices
+    ){
+    const __mmask16 smaller = _mm512_cmp_ps_mask(values, best, _CMP_LT_OQ);
+    best = _mm512_mask_blend_ps(smaller, best, values);
+    bestIndices = _mm512_mask_blend_epi32(smaller, bestIndices, valuesIndices);
+}
+
+///Reduces the lanes of a running argmin to the smallest value and the lowest index holding it, without leaving the registers
+AVX512_TARGET static inline void avx512ReduceArgmin(
+        __m512      best,
+        __m512i     bestIndices,
+        int         &index,
+        float       &minimum
+    ){
+    //Every lane ends up holding the minimum of all lanes
+    __m512 minima = _mm512_min_ps(best, _mm512_shuffle_f32x4(best, best, 0x4E));
+    minima = _mm512_min_ps(minima, _mm512_shuffle_f32x4(minima, minima, 0xB1));
+    minima = _mm512_min_ps(minima, _mm512_permute_ps(minima, 0x4E));
+    minima = _mm512_min_ps(minima, _mm512_permute_ps(minima, 0xB1));
+    //best starts at +infinity and NaNs never compare lower, so at least one lane holds the minimum
+    __m512i candidates = _mm512_mask_blend_epi32(_mm512_cmp_ps_mask(best, minima, _CMP_EQ_OQ), _mm512_set1_epi32(std::numeric_limits<int>::max()), bestIndices);
+    candidates = _mm512_min_epi32(candidates, _mm512_shuffle_i32x4(candidates, candidates, 0x4E));
+    candidates = _mm512_min_epi32(candidates, _mm512_shuffle_i32x4(candidates, candidates, 0xB1));
+    candidates = _mm512_min_epi32(candidates, _mm512_shuffle_epi32(candidates, _MM_PERM_BADC));
+    candidates = _mm512_min_epi32(candidates, _mm512_shuffle_epi32(candidates, _MM_PERM_CDAB));
+    minimum = _mm_cvtss_f32(_mm512_castps512_ps128(minima));
+    index = _mm_cvtsi128_si32(_mm512_castsi512_si128(candidates));
+}
+
+AVX512_TARGET static void avx512RowsArgmin(
+        const float *rows,
+        Index       rowsNumber,
+        Index       columnsNumber,
+        Index       rowsStride,
+        int         *indices,
+        float       *minima
+    ){
+    const __m512 infinity = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    const __m512i lanesIndices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const Index remaining = columnsNumber % 16;
+    const __mmask16 tailMask = __mmask16((1u << remaining) - 1u);
+    for(Index j=0;j<rowsNumber;++j){
+        const float *row = rows + j * rowsStride;
+        __m512 best = infinity;
+        __m512i bestIndices = _mm512_setzero_si512();
+        __m512i columnsIndices = lanesIndices;
+        Index i = 0;
+        for(;i + 16<=columnsNumber;i+=16){
+            avx512RunningArgmin(_mm512_loadu_ps(row + i), columnsIndices, best, bestIndices);
+            columnsIndices = _mm512_add_epi32(columnsIndices, _mm512_set1_epi32(16));
+        }
+        if(remaining){
+            avx512RunningArgmin(_mm512_mask_loadu_ps(infinity, tailMask, row + i), columnsIndices, best, bestIndices);
+        }
+        float minimum;
+        avx512ReduceArgmin(best, bestIndices, indices[j], minimum);
+        if(minima){
+            minima[j] = minimum;
+        }
+    }
+}
+
+///Computes the distances between a datapoint and Registers registers of centroids of the panel
+template<bool Squared, int Registers>
+AVX512_TARGET static inline void avx512BlockDistances(
+        const float *entity,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        __m512      *distances
+    ){
+#pragma GCC unroll 4
+    for(int r=0;r<Registers;++r){
+        distances[r] = _mm512_setzero_ps();
+    }
+    for(Index s=0;s<statsNumber;++s){
+        const __m512 coordinate = _mm512_set1_ps(entity[s]);
+        const float *panelRow = panel + s * panelColumns;
+#pragma GCC unroll 4
+        for(int r=0;r<Registers;++r){
+            const __m512 difference = _mm512_sub_ps(coordinate, _mm512_loadu_ps(panelRow + 16 * r));
+            if constexpr(Squared){
+                distances[r] = _mm512_fmadd_ps(difference, difference, distances[r]);
+            }else{
+                distances[r] = _mm512_add_ps(distances[r], _mm512_abs_ps(difference));
+            }
+        }
+    }
+}
+
+template<bool Squared>
+AVX512_TARGET static void avx512PanelDistances(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        float       *distances,
+        Index       distancesStride
+    ){
+    __m512 blockDistances[avx512BlockRegisters];
+    for(Index j=0;j<entitiesNumber;++j){
+        const float *entity = entities + j * entitiesStride;
+        float *entityDistances = distances + j * distancesStride;
+        Index block = 0;
+        for(;block + 16 * avx512BlockRegisters<=panelColumns;block+=16 * avx512BlockRegisters){
+            avx512BlockDistances<Squared, avx512BlockRegisters>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int r=0;r<avx512BlockRegisters;++r){
+                _mm512_storeu_ps(entityDistances + block + 16 * r, blockDistances[r]);
+            }
+        }
+        for(;block<panelColumns;block+=16){
+            avx512BlockDistances<Squared, 1>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            _mm512_storeu_ps(entityDistances + block, blockDistances[0]);
+        }
+    }
+}
+
+template<bool Squared>
+AVX512_TARGET static void avx512PanelArgmin(
+        const float *entities,
+        Index       entitiesNumber,
+        Index       entitiesStride,
+        const float *panel,
+        Index       statsNumber,
+        Index       panelColumns,
+        int         *indices,
+        float       *minima
+    ){
+    __m512 blockDistances[avx512BlockRegisters];
+    for(Index j=0;j<entitiesNumber;++j){
+        const float *entity = entities + j * entitiesStride;
+        __m512 best = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+        __m512i bestIndices = _mm512_setzero_si512();
+        __m512i columnsIndices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        Index block = 0;
+        for(;block + 16 * avx512BlockRegisters<=panelColumns;block+=16 * avx512BlockRegisters){
+            avx512BlockDistances<Squared, avx512BlockRegisters>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            for(int r=0;r<avx512BlockRegisters;++r){
+                avx512RunningArgmin(blockDistances[r], columnsIndices, best, bestIndices);
+                columnsIndices = _mm512_add_epi32(columnsIndices, _mm512_set1_epi32(16));
+            }
+        }
+        for(;block<panelColumns;block+=16){
+            avx512BlockDistances<Squared, 1>(entity, panel + block, statsNumber, panelColumns, blockDistances);
+            avx512RunningArgmin(blockDistances[0], columnsIndices, best, bestIndices);
+            columnsIndices = _mm512_add_epi32(columnsIndices, _mm512_set1_epi32(16));
+        }
+        float minimum;
+        avx512ReduceArgmin(best, bestIndices, indices[j], minimum);
+        if(minima){
+            minima[j] = minimum;
+        }
+    }
+}
+
+const SimdKernels avx512SimdKernels = {
+    SimdLevel::Avx512,
+    avx512RowsArgmin,
+    avx512PanelDistances<true>,
+    avx512PanelArgmin<true>,
+    avx512PanelDistances<false>,
+    avx512PanelArgmin<false>
+};
+
+#endif
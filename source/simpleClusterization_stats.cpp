@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <simpleClusterization_stats.hpp>
+
+void ClusteringStats::reset(){
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(phaseSeconds, phaseSeconds + clusteringPhasesNumber, 0.);
+    runs                = 0;
+    unconvergedRuns     = 0;
+    iterations          = 0;
+    distanceEvaluations = 0;
+    emptyClusterEvents  = 0;
+    fitnessRetries      = 0;
+    lastResidual        = std::numeric_limits<float>::quiet_NaN();
+    clustersFitness.clear();
+}
+
+void ClusteringStats::addPhaseSeconds(
+        ClusteringPhase phase,
+        double          seconds
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    phaseSeconds[int(phase)] += seconds;
+}
+
+void ClusteringStats::addDistanceEvaluations(
+        long long count
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    distanceEvaluations += count;
+}
+
+void ClusteringStats::recordIteration(
+        const IterationEvent    &event,
+        long long               iterationDistanceEvaluations
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    ++iterations;
+    distanceEvaluations += iterationDistanceEvaluations;
+    lastResidual = event.residual;
+    if(onIteration){
+        onIteration(event);
+    }
+}
+
+void ClusteringStats::recordRun(
+        bool converged
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    ++runs;
+    unconvergedRuns += !converged;
+}
+
+void ClusteringStats::recordEmptyCluster(){
+    std::lock_guard<std::mutex> lock(mutex);
+    ++emptyClusterEvents;
+}
+
+void ClusteringStats::recordFitness(
+        const ClustersFitness &fitness
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    fitnessRetries += fitness.retries;
+    clustersFitness.push_back(fitness);
+}
+
+void ClusteringStats::sortClustersFitness(
+        size_t firstEntry
+    ){
+    std::lock_guard<std::mutex> lock(mutex);
+    std::sort(clustersFitness.begin() + std::min(firstEntry, clustersFitness.size()), clustersFitness.end(), [](const ClustersFitness &a, const ClustersFitness &b){
+        return a.clustersNumber!=b.clustersNumber ? a.clustersNumber < b.clustersNumber : a.attempt < b.attempt;
+    });
+}
@@ -0,0 +1,32 @@
+#include <Eigen/Dense>
+#include <simpleClusterization_common.hpp>
+#include <simpleClusterization_streaming.hpp>
+
+using namespace Eigen;
+
+void miniBatchUpdate(
+        const Ref<const MatrixXfR>  &chunk,
+        const Ref<const VectorXi>   &chunkLabels,
+        Ref<MatrixXf>               centroids,
+        Ref<VectorXd>               centroidsWeights,
+        Ref<MatrixXf>               centroidsSums,
+        Ref<VectorXi>               chunkCounts
+    ){
+    const int chunkRows = chunk.rows();
+    const int clustersNumber = centroids.rows();
+    centroidsSums.setZero();
+    chunkCounts.setZero();
+    for(int j=0;j<chunkRows;++j){
+        centroidsSums.row(chunkLabels(j)) += chunk.row(j);
+        ++chunkCounts(chunkLabels(j));
+    }
+    //Applying c += (x - c) / v for each of the m new datapoints in turn gives c += (sum - m * c) / (v + m)
+    for(int i=0;i<clustersNumber;++i){
+        if(chunkCounts(i)==0){
+            continue;
+        }
+        centroidsWeights(i) += chunkCounts(i);
+        const float learningRate = float(1.0 / centroidsWeights(i));
+        centroids.row(i) += learningRate * (centroidsSums.row(i) - float(chunkCounts(i)) * centroids.row(i));
+    }
+}
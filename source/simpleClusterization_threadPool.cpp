@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <simpleClusterization_threadPool.hpp>
+
+ThreadPool::ThreadPool(int threadsNumber){
+    if(threadsNumber<=0){
+        threadsNumber = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(int i=0;i<threadsNumber;++i){
+        queues.emplace_back(new JobQueue());
+    }
+    for(int i=1;i<threadsNumber;++i){
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        stopping = true;
+    }
+    batchStarted.notify_all();
+    for(std::thread &thread : threads){
+        thread.join();
+    }
+}
+
+void ThreadPool::run(
+        int             jobsNumber,
+        jobTrampoline_t *trampoline,
+        void            *context
+    ){
+    const int workersNumber = size();
+    //Contiguous ranges keep the callers' ordering: worker w starts from the w-th slice of the jobs
+    for(int i=0;i<workersNumber;++i){
+        std::lock_guard<std::mutex> lock(queues[i]->mutex);
+        queues[i]->begin = int((long(jobsNumber) * i) / workersNumber);
+        queues[i]->end   = int((long(jobsNumber) * (i + 1)) / workersNumber);
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        currentTrampoline = trampoline;
+        currentContext = context;
+        busyWorkers = workersNumber - 1;
+        ++batchGeneration;
+    }
+    batchStarted.notify_all();
+    consumeJobs(0);
+    std::unique_lock<std::mutex> lock(batchMutex);
+    batchFinished.wait(lock, [this](){
+        return busyWorkers==0;
+    });
+}
+
+void ThreadPool::workerLoop(
+        int workerIndex
+    ){
+    unsigned long seenGeneration = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(batchMutex);
+            batchStarted.wait(lock, [&](){
+                return stopping || batchGeneration!=seenGeneration;
+            });
+            if(stopping){
+                return;
+            }
+            seenGeneration = batchGeneration;
+        }
+        consumeJobs(workerIndex);
+        bool lastWorker;
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            lastWorker = --busyWorkers==0;
+        }
+        if(lastWorker){
+            batchFinished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::consumeJobs(
+        int workerIndex
+    ){
+    int jobIndex;
+    while(nextJob(workerIndex, jobIndex)){
+        (*currentTrampoline)(currentContext, jobIndex, workerIndex);
+    }
+}
+
+bool ThreadPool::nextJob(
+        int workerIndex,
+        int &jobIndex
+    ){
+    {
+        JobQueue &ownQueue = *queues[workerIndex];
+        std::lock_guard<std::mutex> lock(ownQueue.mutex);
+        if(ownQueue.begin<ownQueue.end){
+            jobIndex = ownQueue.begin++;
+            return true;
+        }
+    }
+    //Our range is exhausted, so we steal the last job of the first worker that still has some, starting from our neighbour
+    const int workersNumber = size();
+    for(int offset=1;offset<workersNumber;++offset){
+        JobQueue &victimQueue = *queues[(workerIndex + offset) % workersNumber];
+        std::lock_guard<std::mutex> lock(victimQueue.mutex);
+        if(victimQueue.begin<victimQueue.end){
+            jobIndex = --victimQueue.end;
+            return true;
+        }
+    }
+    return false;
+}
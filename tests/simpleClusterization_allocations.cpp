@@ -0,0 +1,199 @@
+///@file simpleClusterization_allocations.cpp
+///@brief Checks that the ClusteringContext overloads don't allocate any memory once the context has served a call on data of the same sizes
+///@details Every allocation goes through the replaced global operator new, which counts them. Each entry point is called twice on the same context,
+///         and the second call must not allocate. The exit status is 1 if any of them did.
+///         Build it with the library sources, e.g.
+///             g++ -O2 -std=c++17 -pthread -Iinclude -I/usr/include/eigen3 tests/simpleClusterization_allocations.cpp source/*.cpp -o allocations
+
+#include <Eigen/Dense>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <simpleClusterization.hpp>
+
+using namespace Eigen;
+
+namespace{
+
+std::atomic<long long> allocationsNumber{0};
+
+///The number of failed checks
+int failuresNumber = 0;
+
+/*!
+ * @brief       Runs a call twice and checks that the second run doesn't allocate
+ * @param[in]   name        The name of the check, printed with its result
+ * @param[in]   function    The call
+*/
+template<typename Function>
+void checkSteadyState(
+        const std::string   &name,
+        Function            &&function
+    ){
+    function();
+    const long long before = allocationsNumber.load();
+    function();
+    const long long allocations = allocationsNumber.load() - before;
+    std::printf("%-48s %s (%lld allocations)\n", name.c_str(), allocations==0 ? "ok" : "FAILED", allocations);
+    if(allocations!=0){
+        ++failuresNumber;
+    }
+}
+
+///Gaussian blobs around clustersNumber random centers
+MatrixXfR blobs(
+        int entitiesNumber,
+        int statsNumber,
+        int clustersNumber
+    ){
+    std::mt19937 generator(7);
+    std::normal_distribution<float> normal;
+    std::uniform_real_distribution<float> uniform(-10.f, 10.f);
+    MatrixXf centers(clustersNumber, statsNumber);
+    for(int i=0;i<clustersNumber;++i){
+        for(int s=0;s<statsNumber;++s){
+            centers(i, s) = uniform(generator);
+        }
+    }
+    MatrixXfR entities(entitiesNumber, statsNumber);
+    for(int j=0;j<entitiesNumber;++j){
+        for(int s=0;s<statsNumber;++s){
+            entities(j, s) = centers(j % clustersNumber, s) + normal(generator);
+        }
+    }
+    return entities;
+}
+
+///The name of a kmeans algorithm, for the report
+const char *algorithmName(
+        KmeansAlgorithm algorithm
+    ){
+    switch(algorithm){
+        case KmeansAlgorithm::Lloyd:    return "lloyd";
+        case KmeansAlgorithm::Hamerly:  return "hamerly";
+        case KmeansAlgorithm::Elkan:    return "elkan";
+        default:                        return "automatic";
+    }
+}
+
+}
+
+void *operator new(
+        std::size_t size
+    ){
+    ++allocationsNumber;
+    void *pointer = std::malloc(size ? size : 1);
+    if(!pointer){
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(
+        void *pointer
+    ) noexcept{
+    std::free(pointer);
+}
+
+void operator delete(
+        void        *pointer,
+        std::size_t
+    ) noexcept{
+    std::free(pointer);
+}
+
+int main(){
+    const int entitiesNumber = 4000;
+    const int statsNumber = 8;
+    const int clustersNumber = 5;
+    const int maxClustersNumber = 20;
+    const MatrixXfR entities = blobs(entitiesNumber, statsNumber, clustersNumber);
+    MatrixXf centroids(maxClustersNumber, statsNumber);
+    MatrixXfR weights(maxClustersNumber, entitiesNumber);
+    VectorXi labels(entitiesNumber);
+    VectorXi counts(clustersNumber);
+    for(int threadsNumber : {1, 3}){
+        const std::string threads = " threads=" + std::to_string(threadsNumber);
+        for(KmeansAlgorithm algorithm : {KmeansAlgorithm::Lloyd, KmeansAlgorithm::Hamerly, KmeansAlgorithm::Elkan, KmeansAlgorithm::Automatic}){
+            for(bool warmStart : {false, true}){
+                ClusteringContext context(threadsNumber);
+                SweepOptions options;
+                options.seed = 42;
+                options.warmStart = warmStart;
+                options.kmeans.algorithm = algorithm;
+                checkSteadyState(std::string("clusterGeneratorApproximate ") + algorithmName(algorithm) + (warmStart ? " warm" : "") + threads, [&](){
+                    clusterGeneratorApproximate(entities, centroids, weights, labels, SquaredEuclideanMetric(), options, context);
+                });
+                //The sweep reserves its buffers up front, Elkan's n x k bounds only when Elkan can run
+                const Index boundsSize = algorithm==KmeansAlgorithm::Lloyd ? 0 : algorithm==KmeansAlgorithm::Hamerly ? entitiesNumber : Index(entitiesNumber) * maxClustersNumber;
+                if(!warmStart && context.sweepWorkspaces[0].kmeans.lowerBounds.size()!=boundsSize){
+                    std::printf("%-48s FAILED (%lld lower bounds reserved instead of %lld)\n", (std::string("lowerBounds ") + algorithmName(algorithm) + threads).c_str(),
+                                (long long)context.sweepWorkspaces[0].kmeans.lowerBounds.size(), (long long)boundsSize);
+                    ++failuresNumber;
+                }
+            }
+        }
+        ClusteringContext context(threadsNumber);
+        KmeansOptions kmeansOptions;
+        for(KmeansInitialization initialization : {KmeansInitialization::KmeansPlusPlus, KmeansInitialization::KmeansParallel}){
+            kmeansOptions.initialization = initialization;
+            checkSteadyState(std::string("kmeansGenerator ") + (initialization==KmeansInitialization::KmeansParallel ? "kmeans||" : "kmeans++") + threads, [&](){
+                std::mt19937 generator(1);
+                kmeansGenerator(entities, centroids.topRows(clustersNumber), labels, counts, SquaredEuclideanMetric(), generator, kmeansOptions, context);
+            });
+            checkSteadyState(std::string("kmeansGenerator manhattan ") + (initialization==KmeansInitialization::KmeansParallel ? "kmeans||" : "kmeans++") + threads, [&](){
+                std::mt19937 generator(1);
+                kmeansGenerator(entities, centroids.topRows(clustersNumber), labels, counts, ManhattanMetric(), generator, kmeansOptions, context);
+            });
+        }
+        checkSteadyState("FCMGenerator" + threads, [&](){
+            FCMGenerator(entities, centroids.topRows(clustersNumber), weights.topRows(clustersNumber), SquaredEuclideanMetric(), FcmOptions(), context);
+        });
+        checkSteadyState("calculateLabels" + threads, [&](){
+            calculateLabels(entities, centroids.topRows(clustersNumber), labels, SquaredEuclideanMetric(), context);
+        });
+        for(SilhouetteMode mode : {SilhouetteMode::Exact, SilhouetteMode::Simplified, SilhouetteMode::Sampled}){
+            SilhouetteOptions silhouetteOptions;
+            silhouetteOptions.mode = mode;
+            silhouetteOptions.sampleSize = 1000;
+            checkSteadyState(std::string("silhouetteTest ") + (mode==SilhouetteMode::Exact ? "exact" : mode==SilhouetteMode::Simplified ? "simplified" : "sampled") + threads, [&](){
+                silhouetteTest(entities, centroids.topRows(clustersNumber), labels, SquaredEuclideanMetric(), silhouetteOptions, context);
+            });
+        }
+        //Column-major datapoints are converted into a buffer of the context, where binding them to a Ref<const MatrixXfR> would allocate a copy
+        const MatrixXf columnMajorEntities = entities;
+        SweepOptions options;
+        options.seed = 42;
+        VectorXi columnMajorLabels(entitiesNumber);
+        checkSteadyState("clusterGeneratorApproximate column-major" + threads, [&](){
+            clusterGeneratorApproximate(columnMajorEntities, centroids, weights, columnMajorLabels, SquaredEuclideanMetric(), options, context);
+        });
+        clusterGeneratorApproximate(entities, centroids, weights, labels, SquaredEuclideanMetric(), options, context);
+        if(columnMajorLabels!=labels){
+            std::printf("%-48s FAILED (the labels differ from the row-major ones)\n", ("clusterGeneratorApproximate column-major" + threads).c_str());
+            ++failuresNumber;
+        }
+        checkSteadyState("kmeansGenerator column-major" + threads, [&](){
+            std::mt19937 generator(1);
+            kmeansGenerator(columnMajorEntities, centroids.topRows(clustersNumber), labels, counts, SquaredEuclideanMetric(), generator, kmeansOptions, context);
+        });
+        checkSteadyState("FCMGenerator column-major" + threads, [&](){
+            FCMGenerator(columnMajorEntities, centroids.topRows(clustersNumber), weights.topRows(clustersNumber), SquaredEuclideanMetric(), FcmOptions(), context);
+        });
+        checkSteadyState("silhouetteTest column-major" + threads, [&](){
+            silhouetteTest(columnMajorEntities, centroids.topRows(clustersNumber), labels, SquaredEuclideanMetric(), SilhouetteOptions(), context);
+        });
+        const ClusteringModel model(centroids.topRows(clustersNumber), VectorXi::Ones(clustersNumber));
+        checkSteadyState("ClusteringModel::predict column-major" + threads, [&](){
+            model.predict(columnMajorEntities, labels, SquaredEuclideanMetric(), context);
+        });
+    }
+    if(failuresNumber > 0){
+        std::printf("%d checks allocated memory in steady state\n", failuresNumber);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+///@file simpleClusterization_cancellation.cpp
+///@brief Checks the fuzzy memberships of datapoints very close to a centroid, on data far from the origin
+///@details The matrix product formula of the squared euclidean distances cancels to rounding noise or 0 for such datapoints, so the memberships must come
+///         from distances computed again directly. Each check compares a fast path to the memberships of the plain metric loops.
+///         The exit status is 1 if any check fails.
+///         Build it with the library sources, e.g.
+///             g++ -O2 -std=c++17 -pthread -DNDEBUG -Iinclude -I/usr/include/eigen3 tests/simpleClusterization_cancellation.cpp source/*.cpp -o cancellation
+
+#include <Eigen/Dense>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <simpleClusterization.hpp>
+
+using namespace Eigen;
+
+namespace{
+
+///The number of failed checks
+int failuresNumber = 0;
+
+/*!
+ * @brief       Checks that some memberships are finite and match the expected ones
+ * @param[in]   name        The name of the check, printed with its result
+ * @param[in]   weights     The memberships to check
+ * @param[in]   expected    The memberships computed directly
+*/
+void checkWeights(
+        const std::string           &name,
+        const Ref<const MatrixXfR>  &weights,
+        const Ref<const MatrixXfR>  &expected
+    ){
+    const bool finite = weights.allFinite();
+    const float error = finite ? ((weights - expected).array().abs() / expected.array().abs().max(1.0E-6f)).maxCoeff() : 0.f;
+    const bool passed = finite && error < 1.0E-2f;
+    std::printf("%-40s %s (largest relative error %g%s)\n", name.c_str(), passed ? "ok" : "FAILED", error, finite ? "" : ", not finite");
+    if(!passed){
+        ++failuresNumber;
+    }
+}
+
+///A squared euclidean metric the library doesn't recognize, so that it goes through the plain metric loops
+struct DirectSquaredEuclideanMetric{
+    template<typename DerivedA, typename DerivedB>
+    float operator()(
+            const MatrixBase<DerivedA>  &v1,
+            const MatrixBase<DerivedB>  &v2
+        ) const{
+        return (v1 - v2).squaredNorm();
+    }
+};
+
+}
+
+int main(){
+    const int entitiesNumber = 64;
+    const int statsNumber = 64;
+    const int clustersNumber = 4;
+    //Coordinates around 1000 and centroids 0.05 away from some datapoints, the product formula keeps about 1.0E-1 of absolute precision there
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> uniform(990.f, 1010.f);
+    MatrixXfR entities(entitiesNumber, statsNumber);
+    for(int j=0;j<entitiesNumber;++j){
+        for(int s=0;s<statsNumber;++s){
+            entities(j, s) = uniform(generator);
+        }
+    }
+    MatrixXf centroids(clustersNumber, statsNumber);
+    for(int i=0;i<clustersNumber;++i){
+        centroids.row(i) = entities.row(i * 7);
+        centroids(i, i) += 0.05f;
+    }
+    MatrixXfR expected(clustersNumber, entitiesNumber);
+    calculateFuzzyWeights(entities, centroids, expected, DirectSquaredEuclideanMetric());
+    ClusteringContext context;
+    MatrixXfR weights(clustersNumber, entitiesNumber);
+    calculateFuzzyWeights(entities, centroids, weights, SquaredEuclideanMetric(), context);
+    checkWeights("calculateFuzzyWeights", weights, expected);
+    //Without iterations, FCMGenerator() returns the memberships of the centroids it's given
+    FcmOptions fcmOptions;
+    fcmOptions.initializeFromCentroids = true;
+    fcmOptions.maxIterations = 0;
+    MatrixXf fcmCentroids = centroids;
+    FCMGenerator(entities, fcmCentroids, expected, DirectSquaredEuclideanMetric(), fcmOptions);
+    FCMGenerator(entities, fcmCentroids, weights, SquaredEuclideanMetric(), fcmOptions, context);
+    checkWeights("FCMGenerator memberships", weights, expected);
+    calculateFuzzyWeights(entities, centroids, expected, DirectSquaredEuclideanMetric());
+    expected.array().rowwise() /= expected.colwise().sum().array();
+    const ClusteringModel model(centroids, VectorXi::Ones(clustersNumber));
+    model.predictFuzzy(entities, weights, SquaredEuclideanMetric(), context);
+    checkWeights("ClusteringModel::predictFuzzy", weights, expected);
+    //Keeping all the memberships, the sparse ones expand to the dense ones
+    SparseMemberships sparseWeights(entitiesNumber, clustersNumber);
+    calculateFuzzyWeights(entities, centroids, sparseWeights, SquaredEuclideanMetric(), context);
+    sparseWeights.toDense(weights);
+    checkWeights("sparse calculateFuzzyWeights", weights, expected);
+    FCMGenerator(entities, fcmCentroids, expected, DirectSquaredEuclideanMetric(), fcmOptions);
+    FCMGenerator(entities, fcmCentroids, sparseWeights, SquaredEuclideanMetric(), fcmOptions, context);
+    sparseWeights.toDense(weights);
+    checkWeights("sparse FCMGenerator memberships", weights, expected);
+    if(failuresNumber > 0){
+        std::printf("%d checks failed\n", failuresNumber);
+        return 1;
+    }
+    return 0;
+}